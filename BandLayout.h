@@ -0,0 +1,254 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        BandLayout.h
+//
+// Description:
+//
+//   Where in the spectrum each band sits.  A band layout is just a table
+//   of each band's top cutoff in Hz, and it's generated at compile time
+//   for whatever BAND_COUNT and BAND_SPACING the build asks for, so there
+//   is no limit on the number of bands and nothing to compute at startup.
+//
+//   The classic hand-tuned 16, 24 and 32 band tables are still here and
+//   are still the default for those counts; any other count falls back to
+//   log spacing.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+enum BandSpacing
+{
+	BAND_SPACING_CLASSIC,				// The original hand-tuned tables where there is one, otherwise log
+	BAND_SPACING_LOG,					// Equal ratio from one cutoff to the next
+	BAND_SPACING_MEL,					// Equal steps on the mel scale, which spends more bands on the mids
+	BAND_SPACING_OCTAVE					// Standard fractional octave edges around 1kHz, as many per octave as fit
+};
+
+// Depending on how many bamds have been defined, one of these tables will contain the frequency
+// cutoffs for that "size" of a spectrum display.  Really only the 32 band is "scientific" in any
+// sense, the rest are tuned to look good.  And really only the 16 band has had a lot of work.
+
+static constexpr int cutOffs32Band[32] =
+{
+	10, 20, 25, 31, 40,	50, 63, 80, 100, 125, 160, 200, 250, 315, 400, 500, 630, 800, 1000,
+    1250, 1600, 2000, 2500, 3150, 4000, 5000, 6400, 8000, 10000, 12500, 16500, 20000
+};
+
+static constexpr int cutOffs24Band[24] =
+{
+    40, 80, 150, 220, 270, 320, 380, 440, 540, 630,  800, 1000, 1250, 1600, 2000, 2500, 3150,
+    3800, 4200, 4800, 5400, 6200, 7400, 12500
+};
+
+static constexpr int cutOffs16Band[16] =
+{
+	100, 250, 450, 565, 715, 900, 1125, 1400, 1750, 2250, 2800, 3150, 4000, 5000, 6400, 12500
+};
+
+// ConstexprExp, ConstexprLog, ConstexprPow
+//
+// The standard library's math isn't constexpr, so these are just enough to build the tables at compile time.
+// Both reduce the argument by powers of two and finish with a short series, which is good to far better than
+// a hertz over the audio range.  The device's toolchain is C++11, where a constexpr function is a single return
+// statement, so every loop is written as a recursion that carries its running values along as arguments.
+
+constexpr double CONSTEXPR_LN2 = 0.69314718055994530942;
+
+constexpr int RoundToInt(double x)
+{
+	return (int)(x + (x < 0 ? -0.5 : 0.5));
+}
+
+constexpr double ScaleByPowerOfTwo(double x, int k)
+{
+	return k > 0 ? ScaleByPowerOfTwo(x * 2.0, k - 1)
+		 : k < 0 ? ScaleByPowerOfTwo(x / 2.0, k + 1)
+		 : x;
+}
+
+// Sum of r^n/n! for n from 1 to 23, term carrying r^(n-1)/(n-1)!
+
+constexpr double ExpSeries(double r, int n, double term, double sum)
+{
+	return n < 24 ? ExpSeries(r, n + 1, term * (r / n), sum + term * (r / n)) : sum;
+}
+
+constexpr double ConstexprExp(double x)
+{
+	return ScaleByPowerOfTwo(ExpSeries(x - RoundToInt(x / CONSTEXPR_LN2) * CONSTEXPR_LN2, 1, 1.0, 1.0), RoundToInt(x / CONSTEXPR_LN2));
+}
+
+// Splits x into a mantissa in [1, 2) and a power of two
+
+constexpr int LogExponent(double x)
+{
+	return x >= 2.0 ? LogExponent(x / 2.0) + 1
+		 : x < 1.0  ? LogExponent(x * 2.0) - 1
+		 : 0;
+}
+
+constexpr double LogMantissa(double x)
+{
+	return x >= 2.0 ? LogMantissa(x / 2.0)
+		 : x < 1.0  ? LogMantissa(x * 2.0)
+		 : x;
+}
+
+// log(x) = 2 atanh((x-1)/(x+1)), which converges quickly for x in [1, 2)
+
+constexpr double AtanhSeries(double z2, int n, double term, double sum)
+{
+	return n < 40 ? AtanhSeries(z2, n + 2, term * z2, sum + term / n) : sum;
+}
+
+constexpr double LogOfMantissa(double z)
+{
+	return 2.0 * AtanhSeries(z * z, 1, z, 0.0);
+}
+
+constexpr double ConstexprLog(double x)
+{
+	return LogOfMantissa((LogMantissa(x) - 1.0) / (LogMantissa(x) + 1.0)) + LogExponent(x) * CONSTEXPR_LN2;
+}
+
+constexpr double ConstexprPow(double base, double exponent)
+{
+	return ConstexprExp(exponent * ConstexprLog(base));
+}
+
+constexpr double HzToMel(double hz)
+{
+	return 1127.0 * ConstexprLog(1.0 + hz / 700.0);
+}
+
+constexpr double MelToHz(double mel)
+{
+	return 700.0 * (ConstexprExp(mel / 1127.0) - 1.0);
+}
+
+// ClassicCutoff
+//
+// A band's cutoff from the hand-tuned table for its band count, if there is one
+
+constexpr bool HasClassicTable(size_t bandCount)
+{
+	return bandCount == 16 || bandCount == 24 || bandCount == 32;
+}
+
+constexpr int ClassicCutoff(size_t bandCount, size_t iBand)
+{
+	return bandCount == 16 ? cutOffs16Band[iBand]
+		 : bandCount == 24 ? cutOffs24Band[iBand]
+		 : cutOffs32Band[iBand];
+}
+
+// OctaveCutoff
+//
+// Band edges at 1kHz * 2^((k + 1/2) / perOctave), with the top one as close under highFreq as they go
+
+constexpr int FloorToInt(double x)
+{
+	return (int) x - (x < 0 && x != (int) x ? 1 : 0);
+}
+
+constexpr int AtLeastOne(int n)
+{
+	return n > 1 ? n : 1;
+}
+
+constexpr int BandsPerOctave(size_t bandCount, double lowFreq, double highFreq)
+{
+	return AtLeastOne((int)(bandCount / (ConstexprLog(highFreq / lowFreq) / ConstexprLog(2.0)) + 0.5));
+}
+
+constexpr int OctaveEdge(int k, int perOctave)
+{
+	return (int)(1000.0 * ConstexprPow(2.0, (k + 0.5) / perOctave) + 0.5);
+}
+
+constexpr int OctaveCutoff(size_t bandCount, size_t iBand, int perOctave, double highFreq)
+{
+	return OctaveEdge(FloorToInt(perOctave * ConstexprLog(highFreq / 1000.0) / ConstexprLog(2.0) - 0.5) - (int)(bandCount - 1 - iBand), perOctave);
+}
+
+// SpreadCutoff
+//
+// Log or mel spacing: equal steps from lowFreq to highFreq on one scale or the other
+
+constexpr int SpreadCutoff(BandSpacing spacing, size_t bandCount, size_t iBand, double lowFreq, double highFreq)
+{
+	return (int)((spacing == BAND_SPACING_MEL
+				  ? MelToHz(HzToMel(lowFreq) + (HzToMel(highFreq) - HzToMel(lowFreq)) * ((iBand + 1) / (double) bandCount))
+				  : lowFreq * ConstexprPow(highFreq / lowFreq, (iBand + 1) / (double) bandCount))
+				 + 0.5);
+}
+
+// BandCutoff
+//
+// The top cutoff of one of bandCount bands spanning lowFreq to highFreq.  The lowest band takes everything below
+// its cutoff, so lowFreq is really where its bottom edge would be if it had one.  Classic spacing without a table
+// for the band count falls back to log.
+
+constexpr int BandCutoff(BandSpacing spacing, size_t bandCount, size_t iBand, double lowFreq, double highFreq)
+{
+	return (spacing == BAND_SPACING_CLASSIC && HasClassicTable(bandCount)) ? ClassicCutoff(bandCount, iBand)
+		 : spacing == BAND_SPACING_OCTAVE ? OctaveCutoff(bandCount, iBand, BandsPerOctave(bandCount, lowFreq, highFreq), highFreq)
+		 : SpreadCutoff(spacing, bandCount, iBand, lowFreq, highFreq);
+}
+
+// BandIndices, MakeBandIndices
+//
+// 0, 1, ... BandCount-1 as a parameter pack, so that the table's initializer can be written as one expansion.
+// C++11 has no std::index_sequence, so this is the usual stand-in.
+
+template <size_t... Indices>
+struct BandIndices
+{
+};
+
+template <size_t Count, size_t... Indices>
+struct MakeBandIndices : MakeBandIndices<Count - 1, Count - 1, Indices...>
+{
+};
+
+template <size_t... Indices>
+struct MakeBandIndices<0, Indices...>
+{
+	typedef BandIndices<Indices...> Type;
+};
+
+// BandCutoffTable
+//
+// The cutoffs themselves, one BandCutoff per band, filled in by the compiler
+
+template <size_t BandCount, BandSpacing Spacing, typename Indices = typename MakeBandIndices<BandCount>::Type>
+struct BandCutoffTable;
+
+template <size_t BandCount, BandSpacing Spacing, size_t... Indices>
+struct BandCutoffTable<BandCount, Spacing, BandIndices<Indices...>>
+{
+	static constexpr int Cutoffs[BandCount] = { BandCutoff(Spacing, BandCount, Indices, BAND_LOW_FREQ, BAND_HIGH_FREQ)... };
+};
+
+template <size_t BandCount, BandSpacing Spacing, size_t... Indices>
+constexpr int BandCutoffTable<BandCount, Spacing, BandIndices<Indices...>>::Cutoffs[BandCount];
+
+// BandLayout
+//
+// The cutoff table for a given band count, built by the compiler
+
+template <size_t BandCount, BandSpacing Spacing = BAND_SPACING>
+struct BandLayout : BandCutoffTable<BandCount, Spacing>
+{
+	using BandCutoffTable<BandCount, Spacing>::Cutoffs;
+
+	// How many bands, from the bottom, lie entirely at or below the given frequency
+
+	static constexpr size_t BandsBelow(int hz, size_t count = 0)
+	{
+		return count < BandCount && Cutoffs[count] <= hz ? BandsBelow(hz, count + 1) : count;
+	}
+};
@@ -0,0 +1,167 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Decimator.h
+//
+// Description:
+//
+//   Anti-alias filter and downsampler for the bass half of the analyzer.
+//   At 25kHz a 512 point FFT has bins about 49Hz wide, which is far too
+//   coarse for the bottom bands.  Filtering out everything above the bass
+//   and keeping only every Nth sample lets a FFT of the same size look at
+//   N times as much time, with bins N times narrower, for the price of a
+//   short FIR run only at the output rate.
+//
+//   The decimated signal also has its DC removed, since the ADC's midpoint
+//   offset would otherwise leak into the lowest bins.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+class Decimator
+{
+  private:
+
+	size_t			_factor;			// Keep one sample in this many
+	size_t			_tapCount;
+	float		  * _pTaps;
+	float		  * _vHistory;			// The last _tapCount inputs, stored twice so the taps always see them contiguously
+	size_t			_iHistory;
+	size_t			_phase;				// Inputs since the last output
+	float		  * _vOutput;			// The last _windowSize outputs, circular
+	size_t			_windowSize;		// Must be a power of 2
+	size_t			_iOutput;
+	float			_dcIn;				// DC blocker state
+	float			_dcOut;
+	bool			_primed;			// Whether we've seen the first sample yet
+
+	static constexpr float DC_BLOCK_POLE = 0.995f;
+
+	// Decimator::BuildTaps
+	//
+	// Windowed sinc lowpass with a Blackman window, normalized so DC passes at unity gain
+
+	void BuildTaps(float cutoff, size_t sampleRate)
+	{
+		const double fc     = cutoff / (double) sampleRate;
+		const double center = (_tapCount - 1) / 2.0;
+
+		double sum = 0.0;
+		for (size_t i = 0; i < _tapCount; i++)
+		{
+			double x    = i - center;
+			double sinc = (x == 0.0) ? 2 * fc : sin(2 * M_PI * fc * x) / (M_PI * x);
+			double r    = 2 * M_PI * i / (_tapCount - 1);
+			double w    = 0.42 - 0.5 * cos(r) + 0.08 * cos(2 * r);
+			_pTaps[i]   = (float)(sinc * w);
+			sum        += _pTaps[i];
+		}
+		for (size_t i = 0; i < _tapCount; i++)
+			_pTaps[i] /= sum;
+	}
+
+  public:
+
+	// Decimator
+	//
+	// The filter passes up to cutoff Hz; it wants to be comfortably under half of sampleRate / factor so that
+	// whatever sneaks through its transition band folds back above the frequencies we care about.
+
+	Decimator(size_t factor, size_t tapCount, float cutoff, size_t sampleRate, size_t windowSize)
+		: _factor(factor),
+		  _tapCount(tapCount),
+		  _iHistory(0),
+		  _phase(0),
+		  _windowSize(windowSize),
+		  _iOutput(0),
+		  _dcIn(0.0f),
+		  _dcOut(0.0f),
+		  _primed(false)
+	{
+		_pTaps	  = (float *) malloc(tapCount * sizeof(_pTaps[0]));
+		_vHistory = (float *) calloc(tapCount * 2, sizeof(_vHistory[0]));
+		_vOutput  = (float *) calloc(windowSize, sizeof(_vOutput[0]));
+		BuildTaps(cutoff, sampleRate);
+	}
+
+	~Decimator()
+	{
+		free(_pTaps);
+		free(_vHistory);
+		free(_vOutput);
+	}
+
+	Decimator(const Decimator &) = delete;
+	Decimator & operator=(const Decimator &) = delete;
+
+	size_t Factor() const
+	{
+		return _factor;
+	}
+
+	// Decimator::Bytes
+	//
+	// Memory the decimator owns: the taps, the doubled history and the output window
+
+	size_t Bytes() const
+	{
+		return sizeof(*this) + (_tapCount * 3 + _windowSize) * sizeof(float);
+	}
+
+	// Decimator::Process
+	//
+	// Feeds in the next count samples at the full rate.  Every _factor of them produces one filtered output.
+
+	template <typename T>
+	void Process(const T * pSamples, size_t count)
+	{
+		// Start out as if the first sample had been there forever, or the step from nothing up to the ADC's
+		// midpoint would thump through the bass bands for the first several frames
+
+		if (!_primed && count > 0)
+		{
+			for (size_t t = 0; t < _tapCount * 2; t++)
+				_vHistory[t] = (float) pSamples[0];
+			_dcIn	= (float) pSamples[0];
+			_primed = true;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			float x = (float) pSamples[i];
+			_vHistory[_iHistory] = x;
+			_vHistory[_iHistory + _tapCount] = x;
+			if (++_iHistory == _tapCount)
+				_iHistory = 0;
+
+			if (++_phase < _factor)
+				continue;
+			_phase = 0;
+
+			const float * pHistory = _vHistory + _iHistory;
+			float y = 0.0f;
+			for (size_t t = 0; t < _tapCount; t++)
+				y += pHistory[t] * _pTaps[t];
+
+			float out = y - _dcIn + DC_BLOCK_POLE * _dcOut;
+			_dcIn  = y;
+			_dcOut = out;
+
+			_vOutput[_iOutput] = out;
+			_iOutput = (_iOutput + 1) & (_windowSize - 1);
+		}
+	}
+
+	// Decimator::GetWindow
+	//
+	// Copies out the newest window of decimated samples, oldest first, ready for the FFT
+
+	template <typename T>
+	void GetWindow(T * pDest) const
+	{
+		for (size_t i = 0; i < _windowSize; i++)
+			pDest[i] = (T) _vOutput[(_iOutput + i) & (_windowSize - 1)];
+	}
+};
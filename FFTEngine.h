@@ -0,0 +1,476 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        FFTEngine.h
+//
+// Description:
+//
+//   The FFT engines that SampleBuffer can run its transform on.  Every
+//   engine has the same three steps as arduinoFFT (Windowing, Compute and
+//   ComplexToMagnitude) and works in place on the sample buffers, so the
+//   choice is just a typedef picked by FFT_ENGINE in Globals.h:
+//
+//     FFT_ENGINE_DOUBLE    arduinoFFT, double precision.  The ESP32 FPU is
+//                          single precision only, so this is all software.
+//     FFT_ENGINE_FLOAT     Single precision radix-2 on the FPU
+//     FFT_ENGINE_Q15       16 bit fixed point, block scaled
+//     FFT_ENGINE_Q31       32 bit fixed point, block scaled
+//
+//   The float and fixed point engines treat the input as the real signal
+//   it is and run a half size complex transform on it, and they use a
+//   twiddle table that is built once per FFT size and shared by every
+//   engine of that size.  All of them window with the precomputed tables
+//   from FFTWindow.h; the window is picked by FFT_WINDOW in Globals.h and
+//   can be changed at runtime with SetWindow.
+//
+//   host/FFTCompare.cpp measures each engine's speed and accuracy against
+//   the double precision path.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <limits>
+#include <type_traits>
+
+#define FFT_ENGINE_DOUBLE		0
+#define FFT_ENGINE_FLOAT		1
+#define FFT_ENGINE_Q15			2
+#define FFT_ENGINE_Q31			3
+
+// FFTBitReverse
+//
+// Reorders interleaved (re, im) complex data into bit-reversed index order, which lets the butterflies run in
+// place afterwards
+
+template <typename T>
+inline void FFTBitReverse(T * vData, size_t count)
+{
+	size_t j = 0;
+	for (size_t i = 0; i < count - 1; i++)
+	{
+		if (i < j)
+		{
+			std::swap(vData[2 * i],     vData[2 * j]);
+			std::swap(vData[2 * i + 1], vData[2 * j + 1]);
+		}
+		size_t k = count >> 1;
+		while (k <= j)
+		{
+			j -= k;
+			k >>= 1;
+		}
+		j += k;
+	}
+}
+
+// FFTSplit
+//
+// The real input engines treat N real samples as N/2 complex ones (even samples real, odd samples imaginary)
+// and run a half size transform.  Given Z[k] and Z[N/2-k] of that and the twiddle W[k] of the full size
+// transform, this untangles the bins X[k] and X[N/2-k] of the real N point transform:
+//
+//   Even[k] =     (Z[k] + conj(Z[N/2-k])) / 2
+//   Odd[k]  = -i (Z[k] - conj(Z[N/2-k])) / 2
+//   X[k]     = Even[k] + W[k] Odd[k]
+//   X[N/2-k] = conj(Even[k] - W[k] Odd[k])
+
+template <typename T>
+inline void FFTSplit(T zkr, T zki, T zmr, T zmi, T wr, T wi, T & xkr, T & xki, T & xmr, T & xmi)
+{
+	T evenR = (zkr + zmr) * T(0.5);
+	T evenI = (zki - zmi) * T(0.5);
+	T oddR  = (zki + zmi) * T(0.5);
+	T oddI  = (zmr - zkr) * T(0.5);
+	T tr    = wr * oddR - wi * oddI;
+	T ti    = wr * oddI + wi * oddR;
+
+	xkr = evenR + tr;
+	xki = evenI + ti;
+	xmr = evenR - tr;
+	xmi = ti - evenI;
+}
+
+// FFTTwiddles
+//
+// For an N point transform, N/2 interleaved (cos, -sin) pairs of e^(-2*pi*i*k/N), in the engine's number format.
+// Built the first time any engine of that size asks and never freed; at most one table per size and type.
+
+template <typename T>
+class FFTTwiddles
+{
+	static T ToFormat(double value)
+	{
+		if (std::is_floating_point<T>::value)
+			return (T) value;
+
+		const double fullScale = (double) std::numeric_limits<T>::max();
+		return (T) std::max(-fullScale, std::min(fullScale, round(value * fullScale)));
+	}
+
+	typedef T * TableSet[sizeof(size_t) * 8];
+
+	static TableSet & Tables()
+	{
+		static TableSet tables = { nullptr };
+		return tables;
+	}
+
+  public:
+
+	static const T * Get(size_t samples)
+	{
+		TableSet & tables = Tables();
+
+		int power = Log2Int(samples);
+		if (tables[power] == nullptr)
+		{
+			T * pTable = (T *) malloc(samples * sizeof(T));
+			for (size_t k = 0; k < samples / 2; k++)
+			{
+				double angle = 2 * M_PI * k / samples;
+				pTable[2 * k]     = ToFormat(cos(angle));
+				pTable[2 * k + 1] = ToFormat(-sin(angle));
+			}
+			tables[power] = pTable;
+		}
+		return tables[power];
+	}
+
+	// Bytes
+	//
+	// How much memory the tables built so far take up
+
+	static size_t Bytes()
+	{
+		size_t bytes = 0;
+		for (int power = 0; power < (int)(sizeof(size_t) * 8); power++)
+			if (Tables()[power])
+				bytes += ((size_t) 1 << power) * sizeof(T);
+		return bytes;
+	}
+};
+
+// DoubleFFT
+//
+// The original arduinoFFT double precision transform, wrapped up to look like the other engines.  arduinoFFT only does complex
+// transforms, and its forward bit reversal assumes the imaginary half starts out zero, so this one keeps its own
+// zeroed imaginary buffer and runs the full N point transform.  It's here as the reference the others are
+// measured against.
+
+class DoubleFFT
+{
+	arduinoFFT		_FFT;
+	size_t			_samples;
+	const double  * _pWindow;
+	double		  * _vImaginary;
+
+  public:
+
+	typedef double Sample;
+
+	static const char * Name() { return "double"; }
+
+	DoubleFFT(size_t samples, FFTWindowType window = FFT_WINDOW)
+		: _samples(samples),
+		  _pWindow(FFTWindow<double>::Get(window, samples))
+	{
+		_vImaginary = (double *) malloc(samples * sizeof(_vImaginary[0]));
+	}
+
+	~DoubleFFT()
+	{
+		free(_vImaginary);
+	}
+
+	// Memory the engine owns, not counting the shared tables
+
+	size_t Bytes() const
+	{
+		return _samples * sizeof(_vImaginary[0]);
+	}
+
+	DoubleFFT(const DoubleFFT &) = delete;
+	DoubleFFT & operator=(const DoubleFFT &) = delete;
+
+	void SetWindow(FFTWindowType window)
+	{
+		_pWindow = FFTWindow<double>::Get(window, _samples);
+	}
+
+	void Windowing(double * vData)
+	{
+		FFTWindow<double>::Apply(vData, _pWindow, _samples);
+	}
+
+	void Compute(double * vData)
+	{
+		memset(_vImaginary, 0, _samples * sizeof(_vImaginary[0]));
+		_FFT.Compute(vData, _vImaginary, _samples, FFT_FORWARD);
+	}
+
+	void ComplexToMagnitude(double * vData)
+	{
+		_FFT.ComplexToMagnitude(vData, _vImaginary, _samples / 2 + 1);
+	}
+};
+
+// FloatFFT
+//
+// Single precision real input transform.  The N samples are transformed in place as N/2 interleaved complex
+// values with a radix-2 decimation in time, each twiddle loaded once per stage and applied to every butterfly
+// that uses it, and then split back out into the N/2+1 unique bins of the real spectrum.  That's half the
+// butterflies of an N point complex transform and no imaginary buffer at all.
+//
+// The twiddle table is the N point one; the half size transform just takes every other entry.
+
+class FloatFFT
+{
+	size_t			_samples;
+	const float   * _pTwiddles;
+	const float   * _pWindow;
+
+  public:
+
+	typedef float Sample;
+
+	static const char * Name() { return "float32"; }
+
+	FloatFFT(size_t samples, FFTWindowType window = FFT_WINDOW)
+		: _samples(samples),
+		  _pTwiddles(FFTTwiddles<float>::Get(samples)),
+		  _pWindow(FFTWindow<float>::Get(window, samples))
+	{
+	}
+
+	size_t Bytes() const
+	{
+		return 0;
+	}
+
+	void SetWindow(FFTWindowType window)
+	{
+		_pWindow = FFTWindow<float>::Get(window, _samples);
+	}
+
+	void Windowing(float * vData)
+	{
+		FFTWindow<float>::Apply(vData, _pWindow, _samples);
+	}
+
+	// Leaves the spectrum in the usual packed real FFT layout: X[0] and X[N/2], which are both real, share the
+	// first slot, and slot k holds X[k] for 0 < k < N/2.
+
+	void Compute(float * vData)
+	{
+		const size_t count = _samples / 2;
+
+		FFTBitReverse(vData, count);
+
+		for (size_t half = 1, stride = count; half < count; half <<= 1, stride >>= 1)
+		{
+			for (size_t k = 0; k < half; k++)
+			{
+				const float wr = _pTwiddles[2 * k * stride];
+				const float wi = _pTwiddles[2 * k * stride + 1];
+				for (size_t a = k; a < count; a += 2 * half)
+				{
+					float * pA = &vData[2 * a];
+					float * pB = &vData[2 * (a + half)];
+					float   tr = wr * pB[0] - wi * pB[1];
+					float   ti = wr * pB[1] + wi * pB[0];
+					pB[0]  = pA[0] - tr;
+					pB[1]  = pA[1] - ti;
+					pA[0] += tr;
+					pA[1] += ti;
+				}
+			}
+		}
+
+		float z0r = vData[0];
+		float z0i = vData[1];
+		vData[0] = z0r + z0i;
+		vData[1] = z0r - z0i;
+
+		for (size_t k = 1; k <= count / 2; k++)
+		{
+			size_t m = count - k;
+			FFTSplit(vData[2 * k], vData[2 * k + 1], vData[2 * m], vData[2 * m + 1],
+					 _pTwiddles[2 * k], _pTwiddles[2 * k + 1],
+					 vData[2 * k], vData[2 * k + 1], vData[2 * m], vData[2 * m + 1]);
+		}
+	}
+
+	// Magnitudes go to vData[0..N/2], same place and scale as the complex transform would put them.  Going up
+	// from the bottom, bin k overwrites slot k/2, which has always been consumed by then.
+
+	void ComplexToMagnitude(float * vData)
+	{
+		const size_t count   = _samples / 2;
+		const float  nyquist = fabsf(vData[1]);
+
+		vData[0] = fabsf(vData[0]);
+		for (size_t k = 1; k < count; k++)
+			vData[k] = sqrtf(vData[2 * k] * vData[2 * k] + vData[2 * k + 1] * vData[2 * k + 1]);
+		vData[count] = nyquist;
+	}
+};
+
+// FixedFFT
+//
+// The same real input transform in block floating point: the windowed input is scaled so its largest complex
+// pair just fits the word, every stage halves its outputs so nothing can overflow, and the split and magnitudes
+// are done in float on the way back out, scaled so they come out in the same units as the other engines.  The
+// transform itself runs on an integer scratch array owned by the engine.
+
+template <typename T, typename TWide, int FRACBITS>
+class FixedFFT
+{
+	size_t			_samples;
+	const T		  * _pTwiddles;
+	const float   * _pWindow;
+	T			  * _vScratch;
+	float			_outputScale;
+
+	static T Round(TWide value)
+	{
+		return (T)((value + ((TWide)1 << (FRACBITS - 1))) >> FRACBITS);
+	}
+
+  public:
+
+	typedef float Sample;
+
+	static const char * Name() { return FRACBITS == 15 ? "Q15" : "Q31"; }
+
+	FixedFFT(size_t samples, FFTWindowType window = FFT_WINDOW)
+		: _samples(samples),
+		  _pTwiddles(FFTTwiddles<T>::Get(samples)),
+		  _pWindow(FFTWindow<float>::Get(window, samples)),
+		  _outputScale(1.0f)
+	{
+		_vScratch = (T *) malloc(samples * sizeof(T));
+	}
+
+	~FixedFFT()
+	{
+		free(_vScratch);
+	}
+
+	size_t Bytes() const
+	{
+		return _samples * sizeof(_vScratch[0]);
+	}
+
+	FixedFFT(const FixedFFT &) = delete;
+	FixedFFT & operator=(const FixedFFT &) = delete;
+
+	void SetWindow(FFTWindowType window)
+	{
+		_pWindow = FFTWindow<float>::Get(window, _samples);
+	}
+
+	// FixedFFT::Windowing
+	//
+	// Expects a window with its DC already out, as SampleBuffer hands them over: RemoveDC clears the main windows
+	// and the decimator's DC blocker the bass ones.  DC would otherwise set the block scale below and leave the
+	// audio a few bits at the bottom of the word, where rounding lights every band.
+
+	void Windowing(float * vData)
+	{
+		FFTWindow<float>::Apply(vData, _pWindow, _samples);
+	}
+
+	void Compute(float * vData)
+	{
+		const size_t count = _samples / 2;
+
+		// |re| + |im| bounds the magnitude, and no butterfly output can exceed the largest input magnitude
+
+		float peak = 0.0f;
+		for (size_t i = 0; i < count; i++)
+			peak = std::max(peak, fabsf(vData[2 * i]) + fabsf(vData[2 * i + 1]));
+
+		const float fullScale = (float) std::numeric_limits<T>::max() * 0.999f;
+		const float scale     = (peak > 0.0f) ? fullScale / peak : 1.0f;
+		for (size_t i = 0; i < _samples; i++)
+			_vScratch[i] = (T) lrintf(vData[i] * scale);
+
+		FFTBitReverse(_vScratch, count);
+
+		for (size_t half = 1, stride = count; half < count; half <<= 1, stride >>= 1)
+		{
+			for (size_t k = 0; k < half; k++)
+			{
+				const TWide wr = _pTwiddles[2 * k * stride];
+				const TWide wi = _pTwiddles[2 * k * stride + 1];
+				for (size_t a = k; a < count; a += 2 * half)
+				{
+					T    * pA = &_vScratch[2 * a];
+					T    * pB = &_vScratch[2 * (a + half)];
+					TWide  tr = Round(wr * pB[0] - wi * pB[1]);
+					TWide  ti = Round(wr * pB[1] + wi * pB[0]);
+					TWide  ar = pA[0];
+					TWide  ai = pA[1];
+					pB[0] = (T)((ar - tr) >> 1);
+					pB[1] = (T)((ai - ti) >> 1);
+					pA[0] = (T)((ar + tr) >> 1);
+					pA[1] = (T)((ai + ti) >> 1);
+				}
+			}
+		}
+
+		_outputScale = (float) count / scale;							// One halving per stage is a factor of N/2 overall
+	}
+
+	void ComplexToMagnitude(float * vData)
+	{
+		const size_t count    = _samples / 2;
+		const float  twiddle  = 1.0f / (float) std::numeric_limits<T>::max();
+		const T    * pZ       = _vScratch;
+
+		vData[0]     = fabsf((float) pZ[0] + (float) pZ[1]) * _outputScale;
+		vData[count] = fabsf((float) pZ[0] - (float) pZ[1]) * _outputScale;
+
+		for (size_t k = 1; k <= count / 2; k++)
+		{
+			size_t m = count - k;
+			float  xkr, xki, xmr, xmi;
+			FFTSplit((float) pZ[2 * k], (float) pZ[2 * k + 1], (float) pZ[2 * m], (float) pZ[2 * m + 1],
+					 _pTwiddles[2 * k] * twiddle, _pTwiddles[2 * k + 1] * twiddle,
+					 xkr, xki, xmr, xmi);
+			vData[k] = sqrtf(xkr * xkr + xki * xki) * _outputScale;
+			vData[m] = sqrtf(xmr * xmr + xmi * xmi) * _outputScale;
+		}
+	}
+};
+
+typedef FixedFFT<int16_t, int32_t, 15> Q15FFT;
+typedef FixedFFT<int32_t, int64_t, 31> Q31FFT;
+
+// FFTEngine
+//
+// The engine SampleBuffer is built with
+
+#if   FFT_ENGINE == FFT_ENGINE_DOUBLE
+	typedef DoubleFFT	FFTEngine;
+#elif FFT_ENGINE == FFT_ENGINE_FLOAT
+	typedef FloatFFT	FFTEngine;
+#elif FFT_ENGINE == FFT_ENGINE_Q15
+	typedef Q15FFT		FFTEngine;
+#elif FFT_ENGINE == FFT_ENGINE_Q31
+	typedef Q31FFT		FFTEngine;
+#else
+	#error Unknown FFT_ENGINE
+#endif
+
+// FFTTableBytes
+//
+// Memory taken by every twiddle and window table built so far, whichever engines asked for them
+
+inline size_t FFTTableBytes()
+{
+	return FFTTwiddles<float>::Bytes() + FFTTwiddles<int16_t>::Bytes() + FFTTwiddles<int32_t>::Bytes()
+		 + FFTWindow<float>::Bytes() + FFTWindow<double>::Bytes();
+}
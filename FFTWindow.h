@@ -0,0 +1,145 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        FFTWindow.h
+//
+// Description:
+//
+//   Window functions for the FFT engines, computed once per window type
+//   and FFT size and then just multiplied in on every frame, so there's no
+//   cosine left on the per-frame path.
+//
+//   Every window has a different coherent gain (its average weight), which
+//   is how much it scales a steady tone.  The tables are stored already
+//   corrected to the Hamming window's gain, which is what the auto gain and
+//   the band tuning were all done with, so switching windows changes the
+//   leakage and the bin shape but not the band levels.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+enum FFTWindowType
+{
+	FFT_WINDOW_HANN,
+	FFT_WINDOW_HAMMING,
+	FFT_WINDOW_BLACKMAN_HARRIS,
+	FFT_WINDOW_FLAT_TOP,
+	FFT_WINDOW_COUNT
+};
+
+// FFTWindowName
+
+inline const char * FFTWindowName(FFTWindowType type)
+{
+	static const char * names[FFT_WINDOW_COUNT] = { "Hann", "Hamming", "Blackman-Harris", "Flat top" };
+	return names[type];
+}
+
+// FFTWindowWeight
+//
+// The raw weight of sample i of an N sample window.  These are all cosine sums, evaluated symmetrically over
+// i / (N-1) the way arduinoFFT does.
+
+inline double FFTWindowWeight(FFTWindowType type, size_t i, size_t samples)
+{
+	const double r = 2 * M_PI * i / (double)(samples - 1);
+
+	switch (type)
+	{
+		case FFT_WINDOW_HANN:
+			return 0.5 - 0.5 * cos(r);
+		case FFT_WINDOW_HAMMING:
+			return 0.54 - 0.46 * cos(r);
+		case FFT_WINDOW_BLACKMAN_HARRIS:
+			return 0.35875 - 0.48829 * cos(r) + 0.14128 * cos(2 * r) - 0.01168 * cos(3 * r);
+		case FFT_WINDOW_FLAT_TOP:
+			return 0.21557895 - 0.41663158 * cos(r) + 0.277263158 * cos(2 * r) - 0.083578947 * cos(3 * r) + 0.006947368 * cos(4 * r);
+		default:
+			return 1.0;
+	}
+}
+
+// FFTWindowCoherentGain
+//
+// Average weight of the window over N samples: a full scale tone comes out of the FFT scaled by this much
+
+inline double FFTWindowCoherentGain(FFTWindowType type, size_t samples)
+{
+	double sum = 0.0;
+	for (size_t i = 0; i < samples; i++)
+		sum += FFTWindowWeight(type, i, samples);
+	return sum / samples;
+}
+
+// FFTWindowLevelCorrection
+//
+// What the raw weights get multiplied by so the window's coherent gain matches the Hamming window's
+
+inline double FFTWindowLevelCorrection(FFTWindowType type, size_t samples)
+{
+	return FFTWindowCoherentGain(FFT_WINDOW_HAMMING, samples) / FFTWindowCoherentGain(type, samples);
+}
+
+// FFTWindow
+//
+// Level corrected window tables in the engine's sample type, built the first time any engine asks for a
+// given window and size and never freed.
+
+template <typename T>
+class FFTWindow
+{
+  private:
+
+	typedef T * TableSet[FFT_WINDOW_COUNT][sizeof(size_t) * 8];
+
+	static TableSet & Tables()
+	{
+		static TableSet tables = { { nullptr } };
+		return tables;
+	}
+
+  public:
+
+	static const T * Get(FFTWindowType type, size_t samples)
+	{
+		TableSet & tables = Tables();
+
+		int power = Log2Int(samples);
+		if (tables[type][power] == nullptr)
+		{
+			const double correction = FFTWindowLevelCorrection(type, samples);
+
+			T * pTable = (T *) malloc(samples * sizeof(T));
+			for (size_t i = 0; i < samples; i++)
+				pTable[i] = (T)(FFTWindowWeight(type, i, samples) * correction);
+			tables[type][power] = pTable;
+		}
+		return tables[type][power];
+	}
+
+	// Bytes
+	//
+	// How much memory the tables built so far take up
+
+	static size_t Bytes()
+	{
+		size_t bytes = 0;
+		for (int type = 0; type < FFT_WINDOW_COUNT; type++)
+			for (int power = 0; power < (int)(sizeof(size_t) * 8); power++)
+				if (Tables()[type][power])
+					bytes += ((size_t) 1 << power) * sizeof(T);
+		return bytes;
+	}
+
+	// Apply
+	//
+	// A straight elementwise multiply the compiler can vectorize
+
+	static void Apply(T * __restrict vData, const T * __restrict pWindow, size_t samples)
+	{
+		for (size_t i = 0; i < samples; i++)
+			vData[i] *= pWindow[i];
+	}
+};
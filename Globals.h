@@ -0,0 +1,96 @@
+//+-----------------------------------------------------------------------------
+//
+// DAV - Dave's Audio Visualizer - (c) 2018 Dave Plummer, All Rights Reserved.
+//
+// File:        Globals.h
+//
+// Description:
+//
+//   Build configuration and the global state shared by the sampler, the
+//   display, and the UI.  Split out of the sketch so that the host build
+//   (see host/) can compile the same headers without the ESP32 toolchain.
+//   Any of the #defines can be overridden on the compiler command line.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#ifndef BAND_COUNT
+#define BAND_COUNT			16                              // Any count you like.  Only 16 is "pretty" and hand-tuned, but you could fix others
+#endif
+#ifndef BAND_SPACING
+#define BAND_SPACING  BAND_SPACING_CLASSIC                  // How the bands are spread over the spectrum (see BandLayout.h)
+#endif
+#define BAND_LOW_FREQ       40                              // Bottom and top of the generated band layouts, in Hz
+#define BAND_HIGH_FREQ   12500
+#ifndef BAND_EQ_TILT
+#define BAND_EQ_TILT      1.0f                              // Spectrum the band EQ flattens, as power ~ 1/f^tilt: 0 is white noise, 1 pink
+#endif
+#ifndef MATRIX_WIDTH
+#define MATRIX_WIDTH		48                              // Number of pixels wide
+#endif
+#ifndef MATRIX_HEIGHT
+#define MATRIX_HEIGHT		16                              // Number of pixels tall
+#endif
+#ifndef MATRIX_WIRING
+#define MATRIX_WIRING  MATRIX_WIRING_SERPENTINE             // How the LEDs are chained through the panel (see LEDMatrixGFX.h)
+#endif
+#define GAIN_DAMPEN          2                              // Higher values cause auto gain to react more slowly
+#ifndef BAND_ATTACK_MS
+#define BAND_ATTACK_MS      10                              // Time constant of the bars rising between FFT frames; 0 follows them exactly
+#endif
+#ifndef BAND_RELEASE_MS
+#define BAND_RELEASE_MS      0                              //   ...and of them falling, on top of the peak decay
+#endif
+#ifndef FFT_ENGINE
+#define FFT_ENGINE  FFT_ENGINE_FLOAT                        // Which FFT engine the sampler runs (see FFTEngine.h)
+#endif
+#ifndef FFT_WINDOW
+#define FFT_WINDOW  FFT_WINDOW_HAMMING                      // Window function applied before the FFT (see FFTWindow.h)
+#endif
+#ifndef FFT_OVERLAP
+#define FFT_OVERLAP          1                              // FFTs run per window's worth of new samples: 1 = no overlap, 2 = 50%, 4 = 75%
+#endif
+#ifndef BASS_DECIMATION
+#define BASS_DECIMATION      8                              // Bass bands come from a FFT of the input decimated by this much; 1 turns it off
+#endif
+#ifndef BASS_CROSSOVER
+#define BASS_CROSSOVER     500                              // Bands whose top cutoff is at or below this (Hz) are bass bands
+#endif
+#define LED_PIN				 5                              // Data pin for matrix leds
+#define INPUT_PIN			 2                              // Audio line input 
+#define COLOR_SPEED_PIN     33                              // How fast palette rotates in spectrum bars 
+#define MAX_COLOR_SPEED     64                              //    ...and the max allowed
+#define BRIGHTNESS_PIN		25                              // Pin for brightness pot read
+#define PEAK_DECAY_PIN      26                              // Pin for peak decay pot read
+#define COLOR_SCHEME_PIN    27                              // Pin for controlling color scheme
+#define SUPERSAMPLES         2                              // How many supersamples to take 
+#define SAMPLE_BITS         12								// Sample resolution (0-4095)
+#define MAX_ANALOG_IN    ((1<<SAMPLE_BITS)*SUPERSAMPLES)    // What our max analog input value is on all analog pins (4096 is default 12 bit resolution)
+#define MAX_VU           12000                              // How high our VU could max out at.  Arbitarily tuned.
+#define ONSCREEN_FPS         0                              // Debugging display of FPS count on LED screen
+#define SERIAL_FRAME_PACING  0                              // Debugging output of each second's render and show times on the serial port
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION      1                              // Stage latency histograms (see Instrumentation.h); 0 compiles them out
+#endif
+#define MS_PER_SECOND     1000                              // 1000 milliseconds per second
+#define STACK_SIZE        4096							    // Stack size for each new thread
+
+#define BLACK			0x0000                              // Color definitions in 16-bit 5-6-5 space
+#define BLUE			0x001F
+#define RED				0xF800
+#define GREEN			0x07E0
+#define CYAN			0x07FF
+#define MAGENTA			0xF81F
+#define YELLOW			0xFFE0 
+#define WHITE			0xFFFF
+
+volatile float         gScaler       = 0.0f;                // Instanteous read of LED display vertical scaling
+volatile size_t        gFPS          = 0;				    // FFT frames per second
+volatile size_t        mFPS          = 0;				    // Matrix frames per second
+volatile float         gLogScale     = 2.0f;                // How exponential the peaks are made to be
+volatile float         gBrightness   = 64;                  // LED matrix brightness, 0-255
+volatile float         gPeakDecay    = 0.0;                 // Peak decay for white line on top of spectrum bars
+volatile float         gColorSpeed   = 128.0f;              // How fast the color palette rotates (smaller is faster, it's a time divisor)
+volatile float         gVU			 = 0;                   // Instantaneous read of VU value
+volatile int           giColorScheme = 0;                   // Global color scheme (index into table of palettes)
@@ -0,0 +1,229 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Instrumentation.h
+//
+// Description:
+//
+//   Latency histograms for each stage of the pipeline, from the timer ISR
+//   through to the LEDs.  A ScopedStageTimer placed at the top of a stage
+//   reads the CPU cycle counter on the way in and out and drops the
+//   difference into that stage's histogram, which costs a few dozen cycles
+//   and never takes a lock, so it is cheap enough to leave on in the ISR.
+//   The counter is per core, which is fine since every task is pinned.
+//   There is one histogram per stage, not per analyzer: with several
+//   analyzers running, a stage's histogram holds all of their timings.
+//
+//   The histograms have a fixed set of buckets, four to an octave, so the
+//   percentiles they report are good to within about 20%.  Dump() prints
+//   the count, p50, p99 and max of every stage to the serial port and
+//   Reset() starts them all over; the sketch does either when it gets a
+//   'd' or an 'r' on the serial port.
+//
+//   One more histogram isn't a stage but the sum of them: the latency from
+//   the newest sample in a window to its peaks reaching the display.
+//
+//   Set INSTRUMENTATION to 0 to compile all of it out.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+enum PipelineStage
+{
+	STAGE_ISR,
+	STAGE_LOAD_SAMPLES,
+	STAGE_FFT,
+	STAGE_PROCESS_PEAKS,
+	STAGE_SET_PEAKS,
+	STAGE_DRAW,
+	STAGE_SHOW_MATRIX,
+	STAGE_SAMPLE_TO_PEAKS,									// Not a stage, the latency from sample to SetPeaks
+	STAGE_COUNT
+};
+
+static const char * const StageNames[STAGE_COUNT] =
+{
+	"ISR", "LoadSamples", "FFT", "ProcessPeaks", "SetPeaks", "Draw", "ShowMatrix", "SampleToPeaks"
+};
+
+// StageHistogram
+//
+// Cycle counts bucketed by their top three bits: buckets 4n..4n+3 split the octave [2^n, 2^(n+1)) in four.
+// Every analyzer's tasks and ISRs record into the same stage, from either core, so Record only uses atomic
+// updates; readers just see counts that may be a sample behind.
+
+class StageHistogram
+{
+  private:
+
+	static constexpr size_t BUCKET_COUNT = 32 * 4;
+
+	volatile uint32_t _buckets[BUCKET_COUNT];
+	volatile uint32_t _count;
+	volatile uint32_t _max;
+
+	static inline size_t Bucket(uint32_t cycles) __attribute__((always_inline))
+	{
+		if (cycles < 8)
+			return cycles;
+		int msb = 31 - __builtin_clz(cycles);
+		return msb * 4 + ((cycles >> (msb - 2)) & 3);
+	}
+
+	// The largest cycle count that lands in a bucket
+
+	static uint32_t BucketTop(size_t bucket)
+	{
+		if (bucket < 8)
+			return bucket;
+		int msb = bucket / 4;
+		return (uint32_t)((((uint64_t)(4 + bucket % 4 + 1)) << (msb - 2)) - 1);
+	}
+
+  public:
+
+	StageHistogram()
+	{
+		Reset();
+	}
+
+	inline void Record(uint32_t cycles) __attribute__((always_inline))
+	{
+		__atomic_fetch_add(&_buckets[Bucket(cycles)], 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&_count, 1, __ATOMIC_RELAXED);
+
+		uint32_t max = __atomic_load_n(&_max, __ATOMIC_RELAXED);
+		while (cycles > max && !__atomic_compare_exchange_n(&_max, &max, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			;
+	}
+
+	// StageHistogram::Reset
+	//
+	// Not synchronized with Record, so a sample that lands mid-reset may or may not survive it
+
+	void Reset()
+	{
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+			_buckets[i] = 0;
+		_count = 0;
+		_max   = 0;
+	}
+
+	uint32_t Count() const
+	{
+		return _count;
+	}
+
+	uint32_t Max() const
+	{
+		return _max;
+	}
+
+	// StageHistogram::Percentile
+	//
+	// The cycle count that fraction of the samples came in at or under, to the resolution of the buckets
+
+	uint32_t Percentile(float fraction) const
+	{
+		uint32_t total = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+			total += _buckets[i];
+		if (total == 0)
+			return 0;
+
+		uint32_t target = (uint32_t) ceilf(total * fraction), seen = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			seen += _buckets[i];
+			if (seen >= std::max(target, 1u))
+				return std::min(BucketTop(i), (uint32_t) _max);
+		}
+		return _max;
+	}
+};
+
+// Instrumentation
+//
+// One histogram per stage, shared by every analyzer and display, and the dump and reset that go with them
+
+class Instrumentation
+{
+  private:
+
+	static StageHistogram _stages[STAGE_COUNT];
+
+  public:
+
+	static inline StageHistogram & Stage(PipelineStage stage) __attribute__((always_inline))
+	{
+		return _stages[stage];
+	}
+
+	static float CyclesToMicros(uint32_t cycles)
+	{
+		return cycles / (float) getCpuFrequencyMhz();
+	}
+
+	// Instrumentation::RecordMicros
+	//
+	// For latencies measured with micros() rather than a StageTimer
+
+	static void RecordMicros(PipelineStage stage, unsigned long us)
+	{
+		#if INSTRUMENTATION
+		_stages[stage].Record((uint32_t) std::min<uint64_t>((uint64_t) us * getCpuFrequencyMhz(), UINT32_MAX));
+		#endif
+	}
+
+	static void Reset()
+	{
+		for (int i = 0; i < STAGE_COUNT; i++)
+			_stages[i].Reset();
+	}
+
+	static void Dump()
+	{
+		Serial.printf("%-14s %10s %10s %10s %10s\n", "Stage", "Count", "p50 us", "p99 us", "Max us");
+		for (int i = 0; i < STAGE_COUNT; i++)
+		{
+			const StageHistogram & stage = _stages[i];
+			Serial.printf("%-14s %10u %10.1f %10.1f %10.1f\n", StageNames[i], (unsigned) stage.Count(),
+						  CyclesToMicros(stage.Percentile(0.50f)), CyclesToMicros(stage.Percentile(0.99f)), CyclesToMicros(stage.Max()));
+		}
+	}
+};
+
+StageHistogram Instrumentation::_stages[STAGE_COUNT];
+
+// ScopedStageTimer
+//
+// Times from its construction to the end of its scope into the given stage's histogram
+
+class ScopedStageTimer
+{
+  private:
+
+	StageHistogram & _histogram;
+	uint32_t		 _start;
+
+  public:
+
+	inline ScopedStageTimer(PipelineStage stage) __attribute__((always_inline))
+		: _histogram(Instrumentation::Stage(stage)),
+		  _start(ESP.getCycleCount())
+	{
+	}
+
+	inline ~ScopedStageTimer() __attribute__((always_inline))
+	{
+		_histogram.Record(ESP.getCycleCount() - _start);
+	}
+};
+
+#if INSTRUMENTATION
+#define TIME_STAGE(stage)	ScopedStageTimer _stageTimer(stage)
+#else
+#define TIME_STAGE(stage)
+#endif
@@ -1,141 +1,395 @@
-//+--------------------------------------------------------------------------
-//
-// SoundFrameIQR - (c) 2018 Dave Plummer.  All Rights Reserved.
-//
-// File:        LEDMatrixGFX.h
-//
-// Description:
-//
-//   Provides a Adafruit_GFX implementation for our RGB LED panel so that 
-//   we can use primitives such as lines and fills on it.
-//
-// History:     Sep-11-2018         Davepl      Created/Documented
-//
-//---------------------------------------------------------------------------
-
-#pragma once
-
-// 5:6:5 Color definitions
-#define BLACK16    0x0000
-#define BLUE16     0x001F
-#define RED16      0xF800
-#define GREEN16    0x07E0
-#define CYAN16     0x07FF
-#define MAGENTA16  0xF81F
-#define YELLOW16   0xFFE0
-#define WHITE16    0xFFFF
-
-class LEDMatrixGFX : public Adafruit_GFX
-{
-  private:
-
-	CRGB * _pLEDs = nullptr;
-	size_t _width;
-	size_t _height; 
-
-  public:
-
-	LEDMatrixGFX(size_t w, size_t h, int brightness = 255) 
-		:  Adafruit_GFX((int)w, (int)h),
-		   _width(w),
-		   _height(h)
-	{
-		_pLEDs = static_cast<CRGB *>(calloc(w * h, sizeof(CRGB)));
-		FastLED.addLeds<WS2812B, LED_PIN, GRB>(_pLEDs, w*h);
-		FastLED.setBrightness(brightness);
-	}
-
-	~LEDMatrixGFX()
-	{
-		free(_pLEDs);
-		_pLEDs = nullptr;
-	}
-
-	static const byte gamma5[];
-	static const byte gamma6[];
-	
-	inline static CRGB from16Bit(uint16_t color)								// Convert 16bit 5:6:5 to 24bit color using lookup table for gamma
-	{
-		byte r = gamma5[color >> 11];
-		byte g = gamma6[(color >> 5) & 0x3F];
-		byte b = gamma5[color & 0x1F];
-
-		return CRGB(r, g, b);
-	}
-
-	static inline uint16_t to16bit(uint8_t r, uint8_t g, uint8_t b)				// Convert RGB -> 16bit 5:6:5
-	{
-		return ((r / 8) << 11) | ((g / 4) << 5) | (b / 8);
-	}
-
-	static inline uint16_t to16bit(const CRGB rgb)								// Convert CRGB -> 16 bit 5:6:5
-	{
-		return ((rgb.r / 8) << 11) | ((rgb.g / 4) << 5) | (rgb.b / 8);
-	}
-
-	static inline uint16_t to16bit(CRGB::HTMLColorCode code)					// Convert HtmlColorCode -> 16 bit 5:6:5
-	{
-		return to16bit(CRGB(code));
-	}
-
-	inline uint16_t getPixelIndex(int16_t x, int16_t y) const
-	{
-		if (x & 0x01)
-		{
-			// Odd rows run backwards
-			uint8_t reverseY = (_height - 1) - y;
-			return (x * _height) + reverseY;
-		}
-		else
-		{
-			// Even rows run forwards
-			return (x * _height) + y;
-		}
-	}
-
-	inline CRGB getPixel(int16_t x, int16_t y) const
-	{
-		return _pLEDs[getPixelIndex(x, y)];
-	}
-
-	inline virtual void drawPixel(int16_t x, int16_t y, uint16_t color)
-	{
-		_pLEDs[getPixelIndex(x, y)] = from16Bit(color);
-	}
-
-	inline virtual void drawPixel(int16_t x, int16_t y, CRGB color)
-	{
-		_pLEDs[getPixelIndex(x, y)] = color;
-	}	
-
-	void ShowMatrix()
-	{
-		FastLED.show();
-	}
-
-	void setBrightness(byte brightness)
-	{
-		FastLED.setBrightness(brightness);
-	}
-};
-
-const byte LEDMatrixGFX::gamma5[] =
-{
-  0x00,0x01,0x02,0x03,0x05,0x07,0x09,0x0b,
-  0x0e,0x11,0x14,0x18,0x1d,0x22,0x28,0x2e,
-  0x36,0x3d,0x46,0x4f,0x59,0x64,0x6f,0x7c,
-  0x89,0x97,0xa6,0xb6,0xc7,0xd9,0xeb,0xff 
-};
-
-const byte LEDMatrixGFX::gamma6[] =
-{
-  0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x08,
-  0x09,0x0a,0x0b,0x0d,0x0e,0x10,0x12,0x13,
-  0x15,0x17,0x19,0x1b,0x1d,0x20,0x22,0x25,
-  0x27,0x2a,0x2d,0x30,0x33,0x37,0x3a,0x3e,
-  0x41,0x45,0x49,0x4d,0x52,0x56,0x5b,0x5f,
-  0x64,0x69,0x6e,0x74,0x79,0x7f,0x85,0x8b,
-  0x91,0x97,0x9d,0xa4,0xab,0xb2,0xb9,0xc0,
-  0xc7,0xcf,0xd6,0xde,0xe6,0xee,0xf7,0xff 
-};
-
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIQR - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        LEDMatrixGFX.h
+//
+// Description:
+//
+//   Provides a Adafruit_GFX implementation for our RGB LED panel so that 
+//   we can use primitives such as lines and fills on it.
+//
+//   The Adafruit primitives all work in 16 bit 5:6:5 color and end up in
+//   a virtual drawPixel per pixel, so there are also CRGB versions of the
+//   spans and fills that write straight into the LED buffer at full color
+//   depth.  Anything drawn every frame should use those.
+//
+//   MATRIX_WIRING says how the LED chain snakes through the panel.  Ours
+//   runs down the columns, so a column span is one contiguous run of the
+//   LED buffer and gets filled in one go.
+//
+//     MATRIX_WIRING_SERPENTINE   Column by column, every other one upwards
+//     MATRIX_WIRING_PROGRESSIVE  Column by column, all downwards
+//     MATRIX_WIRING_ROW_MAJOR    Row by row, all left to right
+//
+//   Drawing goes into a back buffer.  Once StartShowTask has been called,
+//   ShowMatrix copies it to the front buffer that FastLED sends out and
+//   hands that to a task of its own, so the next frame is drawn while this
+//   one is still on the wire.  The back buffer keeps its contents, so
+//   incremental drawing still works.
+//
+// History:     Sep-11-2018         Davepl      Created/Documented
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+// 5:6:5 Color definitions
+#define BLACK16    0x0000
+#define BLUE16     0x001F
+#define RED16      0xF800
+#define GREEN16    0x07E0
+#define CYAN16     0x07FF
+#define MAGENTA16  0xF81F
+#define YELLOW16   0xFFE0
+#define WHITE16    0xFFFF
+
+#define MATRIX_WIRING_SERPENTINE	0
+#define MATRIX_WIRING_PROGRESSIVE	1
+#define MATRIX_WIRING_ROW_MAJOR		2
+
+// FramePacing
+//
+// Where the time went on the most recent frame, in microseconds
+
+struct FramePacing
+{
+	uint32_t renderMicros;									// Drawing it: from the last ShowMatrix returning until this one was called
+	uint32_t waitMicros;									// ShowMatrix waiting for the frame before to finish going out
+	uint32_t showMicros;									// FastLED.show() sending it down the wire
+};
+
+class LEDMatrixGFX : public Adafruit_GFX
+{
+  private:
+
+	CRGB * _pLEDs = nullptr;								// Back buffer, where everything draws
+	CRGB * _pFront = nullptr;								// Front buffer, what FastLED sends out
+	size_t _width;
+	size_t _height; 
+
+	TaskHandle_t	  _showTask = nullptr;
+	SemaphoreHandle_t _frameReady = nullptr;				// Given when the front buffer holds a new frame to send
+	SemaphoreHandle_t _showDone = nullptr;					// Given when the front buffer is free to be overwritten
+	volatile bool	  _stopShowTask = false;
+
+	volatile uint8_t  _brightness;							// What the next frame goes out at
+	uint8_t			  _frontBrightness;						// What the one in the front buffer goes out at
+
+	volatile uint32_t _renderMicros = 0;
+	volatile uint32_t _waitMicros = 0;
+	volatile uint32_t _showMicros = 0;
+	unsigned long	  _lastShowReturn = 0;
+
+	// LEDMatrixGFX::ShowTask
+	//
+	// Sends each frame out as ShowMatrix hands it over.  FastLED blocks until the last bit is on the wire, which
+	// is most of the frame time on a big panel, so this is the part we want off the drawing task.  The brightness
+	// comes along with the frame rather than through FastLED's global, which the drawing task could otherwise
+	// change in the middle of a show.
+
+	static void ShowTask(void * pv)
+	{
+		LEDMatrixGFX * pMatrix = (LEDMatrixGFX *) pv;
+		for (;;)
+		{
+			xSemaphoreTake(pMatrix->_frameReady, portMAX_DELAY);
+			if (pMatrix->_stopShowTask)
+				break;
+
+			unsigned long start = micros();
+			FastLED.show(pMatrix->_frontBrightness);
+			pMatrix->_showMicros = micros() - start;
+
+			xSemaphoreGive(pMatrix->_showDone);
+		}
+		xSemaphoreGive(pMatrix->_showDone);
+		vTaskDelete(nullptr);
+	}
+
+  public:
+
+	LEDMatrixGFX(size_t w, size_t h, int brightness = 255) 
+		:  Adafruit_GFX((int)w, (int)h),
+		   _width(w),
+		   _height(h),
+		   _brightness(brightness),
+		   _frontBrightness(brightness)
+	{
+		_pLEDs  = static_cast<CRGB *>(calloc(w * h, sizeof(CRGB)));
+		_pFront = static_cast<CRGB *>(calloc(w * h, sizeof(CRGB)));
+		FastLED.addLeds<WS2812B, LED_PIN, GRB>(_pFront, w*h);
+	}
+
+	~LEDMatrixGFX()
+	{
+		if (_showTask)
+		{
+			xSemaphoreTake(_showDone, portMAX_DELAY);
+			_stopShowTask = true;
+			xSemaphoreGive(_frameReady);
+			xSemaphoreTake(_showDone, portMAX_DELAY);
+			vSemaphoreDelete(_frameReady);
+			vSemaphoreDelete(_showDone);
+		}
+
+		free(_pLEDs);
+		free(_pFront);
+		_pLEDs = nullptr;
+		_pFront = nullptr;
+	}
+
+	// LEDMatrixGFX::StartShowTask
+	//
+	// From here on ShowMatrix returns as soon as the frame is handed off, rather than after it has been sent.
+	// The task wants to sit on the drawing core at a higher priority than the drawing task, since it spends
+	// nearly all of its time blocked waiting for the wire.
+
+	void StartShowTask(int core, unsigned priority, uint32_t stackSize)
+	{
+		if (_showTask)
+			return;
+
+		_frameReady = xSemaphoreCreateBinary();
+		_showDone   = xSemaphoreCreateBinary();
+		xSemaphoreGive(_showDone);
+		xTaskCreatePinnedToCore(ShowTask, "Show Task", stackSize, this, priority, &_showTask, core);
+	}
+
+	FramePacing GetFramePacing() const
+	{
+		return FramePacing { _renderMicros, _waitMicros, _showMicros };
+	}
+
+	static const byte gamma5[];
+	static const byte gamma6[];
+	static const byte gamma8[];
+	
+	inline static CRGB from16Bit(uint16_t color)								// Convert 16bit 5:6:5 to 24bit color using lookup table for gamma
+	{
+		byte r = gamma5[color >> 11];
+		byte g = gamma6[(color >> 5) & 0x3F];
+		byte b = gamma5[color & 0x1F];
+
+		return CRGB(r, g, b);
+	}
+
+	inline static CRGB gammaCorrect(const CRGB rgb)								// The same gamma as from16Bit, but without losing the low bits
+	{
+		return CRGB(gamma8[rgb.r], gamma8[rgb.g], gamma8[rgb.b]);
+	}
+
+	static inline uint16_t to16bit(uint8_t r, uint8_t g, uint8_t b)				// Convert RGB -> 16bit 5:6:5
+	{
+		return ((r / 8) << 11) | ((g / 4) << 5) | (b / 8);
+	}
+
+	static inline uint16_t to16bit(const CRGB rgb)								// Convert CRGB -> 16 bit 5:6:5
+	{
+		return ((rgb.r / 8) << 11) | ((rgb.g / 4) << 5) | (rgb.b / 8);
+	}
+
+	static inline uint16_t to16bit(CRGB::HTMLColorCode code)					// Convert HtmlColorCode -> 16 bit 5:6:5
+	{
+		return to16bit(CRGB(code));
+	}
+
+	inline uint16_t getPixelIndex(int16_t x, int16_t y) const
+	{
+	  #if MATRIX_WIRING == MATRIX_WIRING_ROW_MAJOR
+		return (y * _width) + x;
+	  #else
+		if (MATRIX_WIRING == MATRIX_WIRING_SERPENTINE && (x & 0x01))
+		{
+			// Odd rows run backwards
+			uint8_t reverseY = (_height - 1) - y;
+			return (x * _height) + reverseY;
+		}
+		else
+		{
+			// Even rows run forwards
+			return (x * _height) + y;
+		}
+	  #endif
+	}
+
+	inline CRGB getPixel(int16_t x, int16_t y) const
+	{
+		return _pLEDs[getPixelIndex(x, y)];
+	}
+
+	inline virtual void drawPixel(int16_t x, int16_t y, uint16_t color)
+	{
+		_pLEDs[getPixelIndex(x, y)] = from16Bit(color);
+	}
+
+	inline void drawPixel(int16_t x, int16_t y, CRGB color)						// Not virtual, there's nothing to override
+	{
+		_pLEDs[getPixelIndex(x, y)] = color;
+	}	
+
+	// The CRGB spans and fills below clip to the panel and write the LEDs directly, with no color conversion and
+	// no virtual call per pixel.  The 5:6:5 versions convert once and land in the same place.
+
+	using Adafruit_GFX::drawFastVLine;
+	using Adafruit_GFX::drawFastHLine;
+	using Adafruit_GFX::fillRect;
+	using Adafruit_GFX::fillScreen;
+
+	inline void drawFastVLine(int16_t x, int16_t y, int16_t h, CRGB color)
+	{
+		fillRect(x, y, 1, h, color);
+	}
+
+	inline void drawFastHLine(int16_t x, int16_t y, int16_t w, CRGB color)
+	{
+		fillRect(x, y, w, 1, color);
+	}
+
+	// LEDMatrixGFX::fillColumnSpan
+	//
+	// Fills rows y0 up to (but not including) y1 of column x.  On a column wired panel that's a single run of the
+	// LED buffer, running backwards on the reversed columns of a serpentine one.
+
+	void fillColumnSpan(int16_t x, int16_t y0, int16_t y1, CRGB color)
+	{
+		if (x < 0 || x >= (int) _width)
+			return;
+		y0 = std::max<int>(y0, 0);
+		y1 = std::min<int>(y1, _height);
+		if (y0 >= y1)
+			return;
+
+	  #if MATRIX_WIRING == MATRIX_WIRING_ROW_MAJOR
+		for (int y = y0; y < y1; y++)
+			_pLEDs[(y * _width) + x] = color;
+	  #else
+		if (MATRIX_WIRING == MATRIX_WIRING_SERPENTINE && (x & 0x01))
+			fill_solid(_pLEDs + (x * _height) + (_height - y1), y1 - y0, color);
+		else
+			fill_solid(_pLEDs + (x * _height) + y0, y1 - y0, color);
+	  #endif
+	}
+
+	void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, CRGB color)
+	{
+		int x0 = std::max<int>(x, 0), x1 = std::min<int>(x + w, _width);
+		int y0 = std::max<int>(y, 0), y1 = std::min<int>(y + h, _height);
+		if (x0 >= x1 || y0 >= y1)
+			return;
+
+	  #if MATRIX_WIRING == MATRIX_WIRING_ROW_MAJOR
+		for (int yy = y0; yy < y1; yy++)
+			fill_solid(_pLEDs + (yy * _width) + x0, x1 - x0, color);
+	  #else
+		for (int xx = x0; xx < x1; xx++)
+			fillColumnSpan(xx, y0, y1, color);
+	  #endif
+	}
+
+	inline void fillScreen(CRGB color)
+	{
+		fill_solid(_pLEDs, _width * _height, color);
+	}
+
+	virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+	{
+		fillRect(x, y, 1, h, from16Bit(color));
+	}
+
+	virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+	{
+		fillRect(x, y, w, 1, from16Bit(color));
+	}
+
+	virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+	{
+		fillRect(x, y, w, h, from16Bit(color));
+	}
+
+	virtual void fillScreen(uint16_t color)
+	{
+		fillScreen(from16Bit(color));
+	}
+
+	// LEDMatrixGFX::ShowMatrix
+	//
+	// Sends what's been drawn to the LEDs.  With the show task running this only waits if the frame before is
+	// still going out; the copy to the front buffer is a few microseconds.
+
+	void ShowMatrix()
+	{
+		TIME_STAGE(STAGE_SHOW_MATRIX);
+
+		unsigned long start = micros();
+		_renderMicros = start - _lastShowReturn;
+
+		if (_showTask)
+		{
+			xSemaphoreTake(_showDone, portMAX_DELAY);
+			_waitMicros = micros() - start;
+			memcpy(_pFront, _pLEDs, _width * _height * sizeof(CRGB));
+			_frontBrightness = _brightness;
+			xSemaphoreGive(_frameReady);
+		}
+		else
+		{
+			memcpy(_pFront, _pLEDs, _width * _height * sizeof(CRGB));
+			FastLED.show(_brightness);
+			_waitMicros = 0;
+			_showMicros = micros() - start;
+		}
+
+		_lastShowReturn = micros();
+	}
+
+	// LEDMatrixGFX::setBrightness
+	//
+	// Takes effect from the next ShowMatrix on
+
+	void setBrightness(byte brightness)
+	{
+		_brightness = brightness;
+	}
+};
+
+const byte LEDMatrixGFX::gamma5[] =
+{
+  0x00,0x01,0x02,0x03,0x05,0x07,0x09,0x0b,
+  0x0e,0x11,0x14,0x18,0x1d,0x22,0x28,0x2e,
+  0x36,0x3d,0x46,0x4f,0x59,0x64,0x6f,0x7c,
+  0x89,0x97,0xa6,0xb6,0xc7,0xd9,0xeb,0xff 
+};
+
+const byte LEDMatrixGFX::gamma6[] =
+{
+  0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x08,
+  0x09,0x0a,0x0b,0x0d,0x0e,0x10,0x12,0x13,
+  0x15,0x17,0x19,0x1b,0x1d,0x20,0x22,0x25,
+  0x27,0x2a,0x2d,0x30,0x33,0x37,0x3a,0x3e,
+  0x41,0x45,0x49,0x4d,0x52,0x56,0x5b,0x5f,
+  0x64,0x69,0x6e,0x74,0x79,0x7f,0x85,0x8b,
+  0x91,0x97,0x9d,0xa4,0xab,0xb2,0xb9,0xc0,
+  0xc7,0xcf,0xd6,0xde,0xe6,0xee,0xf7,0xff 
+};
+
+const byte LEDMatrixGFX::gamma8[] =											// gamma6 interpolated out to 8 bits
+{
+  0x00,0x00,0x00,0x01,0x01,0x01,0x01,0x02,0x02,0x02,0x02,0x03,0x03,0x03,0x03,0x04,
+  0x04,0x04,0x04,0x05,0x05,0x05,0x05,0x06,0x06,0x06,0x07,0x07,0x08,0x08,0x08,0x09,
+  0x09,0x09,0x09,0x0a,0x0a,0x0a,0x0a,0x0b,0x0b,0x0b,0x0c,0x0c,0x0d,0x0d,0x0d,0x0e,
+  0x0e,0x0e,0x0f,0x0f,0x10,0x10,0x11,0x11,0x12,0x12,0x12,0x13,0x13,0x13,0x14,0x14,
+  0x15,0x15,0x16,0x16,0x17,0x17,0x18,0x18,0x19,0x19,0x1a,0x1a,0x1b,0x1b,0x1c,0x1c,
+  0x1d,0x1d,0x1e,0x1f,0x1f,0x20,0x20,0x21,0x21,0x22,0x23,0x23,0x24,0x25,0x25,0x26,
+  0x26,0x27,0x28,0x28,0x29,0x2a,0x2b,0x2b,0x2c,0x2d,0x2e,0x2e,0x2f,0x30,0x31,0x31,
+  0x32,0x33,0x34,0x35,0x36,0x37,0x37,0x38,0x39,0x3a,0x3b,0x3c,0x3d,0x3e,0x3e,0x3f,
+  0x40,0x41,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4a,0x4b,0x4c,0x4d,0x4f,
+  0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x58,0x59,0x5a,0x5b,0x5c,0x5d,0x5e,0x5f,0x60,
+  0x62,0x63,0x64,0x65,0x67,0x68,0x69,0x6a,0x6c,0x6d,0x6e,0x6f,0x71,0x72,0x74,0x75,
+  0x76,0x78,0x79,0x7a,0x7c,0x7d,0x7f,0x80,0x82,0x83,0x85,0x86,0x88,0x89,0x8b,0x8c,
+  0x8e,0x8f,0x91,0x92,0x94,0x95,0x97,0x98,0x99,0x9b,0x9c,0x9e,0xa0,0xa2,0xa3,0xa5,
+  0xa7,0xa8,0xaa,0xac,0xae,0xaf,0xb1,0xb3,0xb5,0xb6,0xb8,0xba,0xbb,0xbd,0xbf,0xc1,
+  0xc2,0xc4,0xc6,0xc8,0xca,0xcc,0xce,0xcf,0xd1,0xd3,0xd5,0xd6,0xd8,0xda,0xdc,0xde,
+  0xe0,0xe2,0xe4,0xe6,0xe8,0xea,0xec,0xee,0xf0,0xf3,0xf5,0xf7,0xf9,0xfb,0xfd,0xff 
+};
+
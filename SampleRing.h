@@ -0,0 +1,192 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        SampleRing.h
+//
+// Description:
+//
+//   Lock-free single producer / single consumer ring of raw ADC samples.
+//   The sample source, usually the timer ISR, is the only producer and the
+//   sampler task the only consumer, so neither ever waits on the other: the
+//   source stores a sample, or a whole block, and bumps the head, and the
+//   sampler reads FFT sized windows off the tail whenever enough have piled
+//   up.  Windows can overlap: the sampler can read a full window but only
+//   consume a hop's worth of it, leaving the rest to be read again as the
+//   front of the next window.
+//
+//   The source never checks for room.  If the sampler falls so far behind
+//   that the source laps it, the oldest samples are simply overwritten, and
+//   the sampler notices when it reads, counts them as lost, and skips
+//   forward to the newest full window.
+//
+//   A ring can carry several channels, sampled together by one ISR pass
+//   and stored interleaved as one frame per tick.  Reading a window takes
+//   them apart again, one channel after another, which is the layout the
+//   FFTs want.  Positions and counts are all in frames.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+template <size_t Channels>
+class ChannelRing
+{
+  private:
+
+	uint16_t		* _pSamples;			// Frames of Channels samples each
+	size_t			  _capacity;			// In frames; must be a power of 2
+	size_t			  _mask;
+	volatile uint32_t _head;				// Written only by the producer: count of frames ever pushed
+	uint32_t		  _tail;				// Written only by the consumer: count of frames ever consumed
+
+	uint32_t LoadHead() const
+	{
+		return __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+	}
+
+  public:
+
+	ChannelRing(size_t capacity)
+		: _capacity(capacity),
+		  _mask(capacity - 1),
+		  _head(0),
+		  _tail(0)
+	{
+		_pSamples = (uint16_t *) calloc(capacity * Channels, sizeof(_pSamples[0]));
+	}
+
+	~ChannelRing()
+	{
+		free(_pSamples);
+	}
+
+	ChannelRing(const ChannelRing &) = delete;
+	ChannelRing & operator=(const ChannelRing &) = delete;
+
+	size_t Capacity() const
+	{
+		return _capacity;
+	}
+
+	size_t Bytes() const
+	{
+		return sizeof(*this) + _capacity * Channels * sizeof(_pSamples[0]);
+	}
+
+	// ChannelRing::Push
+	//
+	// Producer side, called from the timer ISR.  A store and an index bump; the release makes sure the frame is
+	// visible to the other core before the new head is.  Returns how many frames have ever been pushed.
+
+	inline uint32_t Push(const uint16_t (&frame)[Channels]) __attribute__((always_inline))
+	{
+		uint32_t   head	= _head;
+		uint16_t * pFrame = _pSamples + (head & _mask) * Channels;
+		for (size_t c = 0; c < Channels; c++)
+			pFrame[c] = frame[c];
+		__atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+		return head + 1;
+	}
+
+	inline uint32_t Push(uint16_t sample) __attribute__((always_inline))
+	{
+		static_assert(Channels == 1, "Push a whole frame at a time");
+
+		const uint16_t frame[1] = { sample };
+		return Push(frame);
+	}
+
+	// ChannelRing::Push
+	//
+	// Producer side, for sources that hand over a block of interleaved frames at a time.  The block goes in as at
+	// most two copies, around the end of the ring, with one release of the head for the lot.
+
+	uint32_t Push(const uint16_t * pFrames, size_t count)
+	{
+		uint32_t head = _head;
+		if (count > _capacity)
+		{
+			pFrames += (count - _capacity) * Channels;		// Only the newest ring's worth would survive anyway
+			head	+= count - _capacity;
+			count	 = _capacity;
+		}
+
+		size_t start = head & _mask;
+		size_t first = std::min(count, _capacity - start);
+		memcpy(_pSamples + start * Channels, pFrames, first * Channels * sizeof(_pSamples[0]));
+		memcpy(_pSamples, pFrames + first * Channels, (count - first) * Channels * sizeof(_pSamples[0]));
+		__atomic_store_n(&_head, head + count, __ATOMIC_RELEASE);
+		return head + count;
+	}
+
+	// ChannelRing::Available
+	//
+	// How many frames are waiting for the consumer.  Can exceed the capacity if the producer has lapped us.
+
+	size_t Available() const
+	{
+		return LoadHead() - _tail;
+	}
+
+	// ChannelRing::Skip
+	//
+	// Consumer side.  Throws away the oldest count frames without reading them.
+
+	void Skip(size_t count)
+	{
+		_tail += count;
+	}
+
+	// ChannelRing::Read
+	//
+	// Consumer side.  Converts the oldest count frames straight from the ring into the caller's buffer, with no
+	// intermediate copy, channel c going to pDest[c * count] onwards, and then consumes the first advance of them.
+	// Only call once Available() >= count.  Returns how many frames were lost because the producer overwrote them
+	// before we got to them; normally zero.
+
+	template <typename T>
+	size_t Read(T * pDest, size_t count, size_t advance)
+	{
+		size_t lost = 0;
+		for (;;)
+		{
+			// If we've been lapped, jump to the newest window that is still intact
+
+			uint32_t head = LoadHead();
+			if (head - _tail > _capacity)
+			{
+				uint32_t newTail = head - count;
+				lost += newTail - _tail;
+				_tail = newTail;
+			}
+
+			size_t start = _tail & _mask;
+			size_t first = std::min(count, _capacity - start);
+			for (size_t c = 0; c < Channels; c++)
+			{
+				const uint16_t * pSource = _pSamples + c;
+				T			   * pOut	 = pDest + c * count;
+				for (size_t i = 0; i < first; i++)
+					pOut[i] = (T) pSource[(start + i) * Channels];
+				for (size_t i = first; i < count; i++)
+					pOut[i] = (T) pSource[(i - first) * Channels];
+			}
+
+			// If the producer got into our window while we were copying it, some of what we read may be newer
+			// than it should be, so go around again
+
+			if (LoadHead() - _tail <= _capacity)
+				break;
+		}
+
+		_tail += advance;
+		return lost;
+	}
+};
+
+// SampleRing
+//
+// The single channel ring that most of the code deals in
+
+typedef ChannelRing<1> SampleRing;
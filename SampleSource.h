@@ -0,0 +1,378 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        SampleSource.h
+//
+// Description:
+//
+//   Where an analyzer's samples come from.  A source pushes frames into
+//   the analyzer's ring, one channel per sample in each frame, at the
+//   sampler's rate, and the analyzer neither knows nor cares how they
+//   were made.  The ADC on its hardware timer is the source the device
+//   runs; the synthetic one generates tones and noise, and the host adds
+//   file and loopback sources in host/HostSources.h.
+//
+//   The ADC delivers a frame per timer interrupt, since that's how it
+//   gets them.  Everything else delivers whole blocks at once, each one a
+//   single copy into the ring and a single release of its head.  Sources
+//   that don't run by themselves deliver only when pumped, which lets the
+//   host drive the analyzer through them as fast as it will go.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+// SamplerTimers
+//
+// The hardware timer ISRs take no argument, so each timer gets its own stub that calls whichever source owns it.
+// The table is indexed by timer, one slot per piece of hardware, shared by sources of every channel count, and
+// only their Start and Stop ever change a slot.
+
+class SamplerTimers
+{
+  public:
+
+	static constexpr uint8_t TIMER_COUNT = 4;
+
+	typedef void (* Handler)(void * pContext);
+
+  private:
+
+	struct Slot
+	{
+		Handler volatile _handler;
+		void  * volatile _pContext;
+	};
+
+	static Slot _slots[TIMER_COUNT];
+
+	template <uint8_t Timer>
+	static void IRAM_ATTR OnTimer()
+	{
+		_slots[Timer]._handler(_slots[Timer]._pContext);
+	}
+
+  public:
+
+	// SamplerTimers::Claim
+	//
+	// Points a free timer's slot at its new owner and returns the stub to attach to the timer.  Returns nullptr
+	// if another source already owns the timer, rather than taking its ISR away from it.
+
+	static void (* Claim(uint8_t timer, Handler handler, void * pContext))()
+	{
+		static void (* const stubs[TIMER_COUNT])() = { OnTimer<0>, OnTimer<1>, OnTimer<2>, OnTimer<3> };
+
+		Handler expected = nullptr;
+		if (!__atomic_compare_exchange_n(&_slots[timer]._handler, &expected, handler, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			return nullptr;
+
+		_slots[timer]._pContext = pContext;
+		return stubs[timer];
+	}
+
+	static void Release(uint8_t timer)
+	{
+		_slots[timer]._handler	= nullptr;
+		_slots[timer]._pContext = nullptr;
+	}
+};
+
+SamplerTimers::Slot SamplerTimers::_slots[SamplerTimers::TIMER_COUNT];
+
+// SampleSource
+//
+// The interface every source implements.  Start hands it the analyzer to deliver to and Stop takes it away again;
+// the analyzer calls both from its own Start and Stop.
+
+template <size_t Channels>
+class SampleSource
+{
+  public:
+
+	typedef MultiChannelAnalyzer<Channels> Analyzer;
+
+	virtual ~SampleSource()
+	{
+	}
+
+	virtual const char * Name() const = 0;
+
+	// SampleSource::Start
+	//
+	// Starts delivering to the analyzer, from the beginning if the source has one.  Returns false if it can't.
+
+	virtual bool Start(Analyzer & analyzer) = 0;
+
+	virtual void Stop() = 0;
+
+	// SampleSource::Pump
+	//
+	// Sources that run by themselves, like the ADC on its timer, deliver whenever they have samples and return 0
+	// here.  The rest deliver only when asked: up to maxFrames more frames, in as few blocks as they can, returning
+	// how many they delivered, which is 0 once they've run dry.
+
+	virtual size_t Pump(size_t /* maxFrames */)
+	{
+		return 0;
+	}
+};
+
+// TimerAdcSource
+//
+// Reads one input pin per channel on a hardware timer.  Each tick the ISR reads every pin in turn and delivers
+// them as one frame, so the channels stay in step.  Everything the ISR touches belongs to the instance, so there
+// can be as many of these as there are timers.
+
+template <size_t Channels>
+class TimerAdcSource : public SampleSource<Channels>
+{
+	typedef MultiChannelAnalyzer<Channels> Analyzer;
+
+  private:
+
+	hw_timer_t	  * _SamplerTimer = NULL;													// The timer which will first SAMPLING_FREQUENCY times per second (like 32000)
+	unsigned int	_sampling_period_us = PERIOD_FROM_FREQ(SAMPLING_FREQUENCY);
+	uint8_t			_inputPins[Channels];													// Which hardware pins do we actually sample audio from?
+	uint8_t			_timerNumber;															// Which of the hardware timers is ours
+	Analyzer	  * _pAnalyzer = nullptr;													// Where the ISR delivers to
+
+	static void IRAM_ATTR OnTimer(void * pContext)
+	{
+		((TimerAdcSource *) pContext)->AcquireSample();
+	}
+
+  public:
+
+	TimerAdcSource(const uint8_t (&inputPins)[Channels], uint8_t timerNumber = 0)
+		: _timerNumber(timerNumber % SamplerTimers::TIMER_COUNT)
+	{
+		for (size_t c = 0; c < Channels; c++)
+			_inputPins[c] = inputPins[c];
+	}
+
+	TimerAdcSource(uint8_t inputPin, uint8_t timerNumber = 0)
+		: _timerNumber(timerNumber % SamplerTimers::TIMER_COUNT)
+	{
+		static_assert(Channels == 1, "Give a pin for every channel");
+
+		_inputPins[0] = inputPin;
+	}
+
+	~TimerAdcSource()
+	{
+		Stop();
+	}
+
+	TimerAdcSource(const TimerAdcSource &) = delete;
+	TimerAdcSource & operator=(const TimerAdcSource &) = delete;
+
+	const char * Name() const override
+	{
+		return "ADC";
+	}
+
+	// TimerAdcSource::AcquireSample
+	//
+	// IRQ calls here through the IRQ stub.  Never waits and never drops: a read of every pin, then the analyzer
+	// stores the frame and bumps an index.
+
+	inline void AcquireSample() __attribute__((always_inline))
+	{
+		TIME_STAGE(STAGE_ISR);
+
+		uint16_t frame[Channels];
+		for (size_t c = 0; c < Channels; c++)
+			frame[c] = analogRead(_inputPins[c]);
+		_pAnalyzer->Deliver(frame);
+	}
+
+	// TimerAdcSource::Start
+    //
+    // Sets a time interrupt to fire every _Samping_period_us (in microseconds).  The timers run on an 80MHz clock
+    // so the scale that down to 1M per second (microseconds).  
+
+	bool Start(Analyzer & analyzer) override
+	{
+		// Timer interrupt
+		_pAnalyzer = &analyzer;
+		void (* stub)() = SamplerTimers::Claim(_timerNumber, OnTimer, this);
+		if (!stub)
+		{
+			Serial.printf("Timer %d is already sampling for another source.\n", _timerNumber);
+			_pAnalyzer = nullptr;
+			return false;
+		}
+
+		for (size_t c = 0; c < Channels; c++)
+			Serial.printf("Continual sampling pin %d every %d us on timer %d for a sample rate of %d Hz.\n", _inputPins[c], _sampling_period_us, _timerNumber, (int) SAMPLING_FREQUENCY);
+
+		_SamplerTimer = timerBegin(_timerNumber, 80, true);		// Scalar for 80Mhz 
+		timerAttachInterrupt(_SamplerTimer, stub, true);			// Set callback
+		timerAlarmWrite(_SamplerTimer, _sampling_period_us, true);	// Set number of 1MHz events to fire upon and set reload == true
+		timerAlarmEnable(_SamplerTimer);
+		return true;
+	}
+
+	// TimerAdcSource::Stop
+	//
+	// Stops our timer and gives it back
+
+	void Stop() override
+	{
+		if (!_SamplerTimer)
+			return;
+
+		timerAlarmDisable(_SamplerTimer);
+		timerDetachInterrupt(_SamplerTimer);
+		timerEnd(_SamplerTimer);
+		_SamplerTimer = NULL;
+		SamplerTimers::Release(_timerNumber);
+		_pAnalyzer = nullptr;
+	}
+};
+
+// SyntheticSource
+//
+// Generates a few tones per channel, plus white noise, at full speed whenever it's pumped.  For a set length, or
+// with no length, forever, which is what a soak test wants.  Levels are fractions of full scale around the ADC's
+// midpoint, and anything past full scale clips at the rails as the ADC would.
+
+template <size_t Channels>
+class SyntheticSource : public SampleSource<Channels>
+{
+	typedef MultiChannelAnalyzer<Channels> Analyzer;
+
+  public:
+
+	static const size_t MAX_TONES	 = 4;				// Per channel
+	static const size_t BLOCK_FRAMES = 256;				// Most frames generated and delivered at once
+
+  private:
+
+	struct Tone
+	{
+		float _step;									// Radians per sample
+		float _amplitude;
+		float _phase;
+	};
+
+	Tone		_tones[Channels][MAX_TONES];
+	size_t		_toneCount[Channels];
+	float		_noise[Channels];
+	uint64_t	_length;								// In frames; 0 for no end
+	uint64_t	_position;
+	uint32_t	_seed;
+	Analyzer  * _pAnalyzer = nullptr;
+	uint16_t	_block[BLOCK_FRAMES * Channels];
+
+	// Xorshift, so the noise is the same every run and costs next to nothing
+
+	float NextNoise()
+	{
+		_seed ^= _seed << 13;
+		_seed ^= _seed >> 17;
+		_seed ^= _seed << 5;
+		return _seed * (2.0f / 4294967296.0f) - 1.0f;
+	}
+
+  public:
+
+	SyntheticSource(float seconds = 0.0f)
+		: _length((uint64_t)(seconds * SAMPLING_FREQUENCY)),
+		  _position(0),
+		  _seed(1)
+	{
+		for (size_t c = 0; c < Channels; c++)
+		{
+			_toneCount[c] = 0;
+			_noise[c]	  = 0.0f;
+		}
+	}
+
+	const char * Name() const override
+	{
+		return "Synthetic";
+	}
+
+	// SyntheticSource::AddTone, SyntheticSource::SetNoise
+	//
+	// What to generate on a channel.  Returns false if the channel already has all the tones it can take.
+
+	bool AddTone(size_t channel, float hz, float amplitude)
+	{
+		if (_toneCount[channel] == MAX_TONES)
+			return false;
+
+		Tone & tone = _tones[channel][_toneCount[channel]++];
+		tone._step		= 2 * (float) M_PI * hz / SAMPLING_FREQUENCY;
+		tone._amplitude = amplitude;
+		tone._phase		= 0.0f;
+		return true;
+	}
+
+	void SetNoise(size_t channel, float amplitude)
+	{
+		_noise[channel] = amplitude;
+	}
+
+	bool Start(Analyzer & analyzer) override
+	{
+		_pAnalyzer = &analyzer;
+		_position  = 0;
+		_seed	   = 1;
+		for (size_t c = 0; c < Channels; c++)
+			for (size_t i = 0; i < _toneCount[c]; i++)
+				_tones[c][i]._phase = 0.0f;
+		return true;
+	}
+
+	void Stop() override
+	{
+		_pAnalyzer = nullptr;
+	}
+
+	size_t Pump(size_t maxFrames) override
+	{
+		if (!_pAnalyzer)
+			return 0;
+		if (_length)
+			maxFrames = (size_t) std::min<uint64_t>(maxFrames, _length - _position);
+
+		size_t delivered = 0;
+		while (delivered < maxFrames)
+		{
+			const size_t count = std::min(maxFrames - delivered, BLOCK_FRAMES);
+			for (size_t c = 0; c < Channels; c++)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					float value = _noise[c] ? _noise[c] * NextNoise() : 0.0f;
+					for (size_t t = 0; t < _toneCount[c]; t++)
+					{
+						Tone & tone = _tones[c][t];
+						value += tone._amplitude * sinf(tone._phase);
+						tone._phase += tone._step;
+						if (tone._phase > 2 * (float) M_PI)
+							tone._phase -= 2 * (float) M_PI;
+					}
+					float adc = MAX_ANALOG_IN / 2 * (1.0f + value);
+					_block[i * Channels + c] = (uint16_t) std::max(0.0f, std::min((float)(MAX_ANALOG_IN - 1), roundf(adc)));
+				}
+			}
+			_pAnalyzer->Deliver(_block, count);
+			delivered += count;
+		}
+		_position += delivered;
+		return delivered;
+	}
+};
+
+// std::min takes its arguments by reference, so under C++11 the constants need a definition of their own
+
+template <size_t Channels>
+const size_t SyntheticSource<Channels>::MAX_TONES;
+
+template <size_t Channels>
+const size_t SyntheticSource<Channels>::BLOCK_FRAMES;
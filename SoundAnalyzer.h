@@ -1,475 +1,942 @@
-//+--------------------------------------------------------------------------
-//
-// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
-//
-// File:        SoundAnalyzer.h 
-//
-// Description:
-//
-//   Interrupt driven code that samples at (for example) 36000Hz on a timer
-//   IRQ.  
-//
-// History:     Sep-12-2018         Davepl      Commented
-//
-//---------------------------------------------------------------------------
-
-#pragma once
-
-const size_t    MAX_SAMPLES		   = 512;
-const size_t    SAMPLING_FREQUENCY = 25000;
-
-#define PRINT_PEAKS				0
-#define SHOW_SAMPLE_TIMING		0
-#define SHOW_FFT_TIMING			0
-
-// Depending on how many bamds have been defined, one of these tables will contain the frequency
-// cutoffs for that "size" of a spectrum display.  Really only the 32 band is "scientific" in any
-// sense, the rest are tuned to look good.  And really only the 16 band has had a lot of work.
-
-static int cutOffs32Band[32] = 
-{
-	10, 20, 25, 31, 40,	50, 63, 80, 100, 125, 160, 200, 250, 315, 400, 500, 630, 800, 1000, 
-    1250, 1600, 2000, 2500, 3150, 4000, 5000, 6400, 8000, 10000, 12500, 16500, 20000
-};
-
-static int cutOffs24Band[24] =
-{
-    40, 80, 150, 220, 270, 320, 380, 440, 540, 630,  800, 1000, 1250, 1600, 2000, 2500, 3150, 
-    3800, 4200, 4800, 5400, 6200, 7400, 12500 
-};
-
-static int cutOffs16Band[16] =
-{
-	100, 250, 450, 565, 715, 900, 1125, 1400, 1750, 2250, 2800, 3150, 4000, 5000, 6400, 12500
-};
-
-static int cutOffs8Band [8] =
-{
-	20, 150, 400, 750, 751, 752, 800, 1200
-};
-
-// SampleBuffer
-//
-// Contains the actual samples; the timer IRQ calls us every 1/Nth of second to take a new sample. When we get full
-// someone will call FFT() and ProcessPeaks() and then GetPeaks() will return a set of peaks, one per band, from
-// that sample data.
-//
-// To maintain a continuous flow of samples (ABC - Always Be Crunching) we acquire the samples under interrupt into
-// one buffer while processing the FFT on the other.  The SamplerController manages who is doing what to what buffer.
-// A Mutex protects each buffer - you must hold the mutex before modifying.
-
-class SampleBuffer
-{
-  private:
-	arduinoFFT		  _FFT;                 // Perhaps could be static, but might have state info, so one per buffer
-	size_t            _MaxSamples;          // Number of samples we will take, must be a power of 2
-	size_t            _SamplingFrequency;   // Sampling Frequency should be at least twice that of highest freq sampled
-	size_t            _BandCount;
-	float			* _vPeaks; 
-	int				  _InputPin;
-	static float      _oldVU;
-	portMUX_TYPE	  _mutex;
-
-	// BucketFrequency
-	//
-	// Return the frequency corresponding to the Nth sample bucket.  Skips the first two 
-	// buckets which are overall amplitude and something else.
-
-	int BucketFrequency(int iBucket) const
-	{
-		if (iBucket <= 1)
-			return 0;
-
-		int iOffset = iBucket - 2;
-		return iOffset * (_SamplingFrequency / 2) / (_MaxSamples / 2);
-	}
-
-	// BandCutoffTable
-	//
-	// Depending on how many bands we have, returns the cutoffs of where those bands are in the spectrum
-
-	static int * BandCutoffTable(int bandCount)				
-	{
-		if (bandCount == 8)
-			return cutOffs8Band;
-		if (bandCount == 16)
-			return cutOffs16Band;
-		if (bandCount == 24)
-			return cutOffs24Band;
-		if (bandCount == 32)
-			return cutOffs32Band;
-		return cutOffs32Band;
-	}
-
-  public:
-
-	volatile int	  _cSamples;
-	double			* _vReal;
-	double			* _vImaginary;
-
-	SampleBuffer(size_t MaxSamples, size_t BandCount, size_t SamplingFrequency, int InputPin)
-	{
-		_BandCount		   = BandCount;
-		_SamplingFrequency = SamplingFrequency;
-		_MaxSamples        = MaxSamples;
-		_InputPin          = InputPin;
-
-		_vReal			   = (double *) malloc(MaxSamples * sizeof(_vReal[0]));
-		_vImaginary		   = (double *) malloc(MaxSamples * sizeof(_vImaginary[0]));
-		_vPeaks			   = (float *)  malloc(BandCount  * sizeof(_vPeaks[0]));
-		_oldVU			   = 0.0f;
-
-		_mutex = portMUX_INITIALIZER_UNLOCKED;
-		vPortCPUInitializeMutex(&_mutex);
-
-		Reset();
-	}
-	~SampleBuffer()
-	{
-		free(_vReal);
-		free(_vImaginary);
-		free(_vPeaks);
-	}
-
-	bool TryForImmediateLock()
-	{
-		return vPortCPUAcquireMutexTimeout(&_mutex, portMUX_TRY_LOCK);
-	}
-
-	void WaitForLock() 
-	{
-		vPortCPUAcquireMutex(&_mutex);
-	}
-
-	void ReleaseLock()
-	{
-		vPortCPUReleaseMutex(&_mutex);
-	}
-    
-    // SampleBuffer::Reset
-    //
-    // Resets (clears) everything about the buffer except for the time stamp.
-
-	void Reset()
-	{
-		_cSamples = 0;
-		for (int i = 0; i < _MaxSamples; i++)
-		{
-			_vReal[i] = 0.0;
-			_vImaginary[i] = 0.0f;
-		}
-		for (int i = 0; i < _BandCount; i++)
-			_vPeaks[i] = 0;
-	}
-
-    // SampleBuffer::FFT
-    //
-    // Run the FFT on the sample buffer.  When done the first two buckets are VU data and only the first MAX_SAMPLES/2
-    // are valid.  For each bucket afterwards you can call BucketFrequency to find out what freq corresponds to what bucket
-
-	void FFT()
-	{
-		#if SHOW_FFT_TIMING
-		unsigned long fftStart = millis();
-		#endif
-
-		_FFT.Windowing(_vReal, _MaxSamples, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
-		_FFT.Compute(_vReal, _vImaginary, _MaxSamples, FFT_FORWARD);
-		_FFT.ComplexToMagnitude(_vReal, _vImaginary, _MaxSamples);              // This and MajorPeak may only actually need _MaxSamples/2
-        _FFT.MajorPeak(_vReal, _MaxSamples, _SamplingFrequency);                //   but I can't tell, and it was no perf win when I tried it.91939193919391939193919391919389191239
-
-		#if SHOW_FFT_TIMING
-		Serial.printf("FFT took %ld ms at %d FPS\n", millis() - fftStart, FPS(fftStart, millis()));
-		#endif
-	}
-	
-	inline bool IsBufferFull() const __attribute__((always_inline))
-	{
-		return (_cSamples >= _MaxSamples);
-	}
-
-    // SampleBuffer::AcquireSample
-    //
-    // IRQ calls here through the IRQ stub
-
-	void AcquireSample()
-	{
-		// If we can't lock the buffer, we just do nothing.  The buffer shouldn't be busy for long, but way too long
-		// to wait on in an ISR, so if we can't lock it immediately, just bail until the next timer IRQ fires.  We keep
-		// some statistics about how many interrupts in total were fired vs how many times we were able to get data vs
-		// how often the buffer was locked.  Ideally you want 99-100% consumption and no misses!
-		
-        g_cInterrupts++;
-
-		if (TryForImmediateLock())				
-		{
-			if (_cSamples < _MaxSamples)
-			{ 
-				_vReal[_cSamples] = analogRead(_InputPin);
-				_vImaginary[_cSamples] = 0;
-				_cSamples++;
-				g_cSamples++;
-			}
-			ReleaseLock();
-		}
-		else
-			g_cIRQMisses++;
-	}
-
-    // SampleBuffer::ProcessPeaks
-    //
-    // Runs through and figures out what the peak level is in each of the bands.  Also calculates
-    // the overall VU level and adjusts the auto gain.
-
-	void ProcessPeaks()
-	{
-		static const int NOISE_CUTOFF = 10;
-
-		float averageSum = 0.0f;
-		double samplesPeak = 0.0f;
-		for (int i = 2; i < _MaxSamples / 2; i++)
-		{
-			averageSum += _vReal[i];
-			if (_vReal[i] > samplesPeak)
-				samplesPeak = _vReal[i];
-		}
-
-		float t = averageSum / (_MaxSamples / 2);
-		gVU = max(t, (_oldVU * 3 + t) / 4);
-		_oldVU = gVU;
-
-		for (int i = 2; i < _MaxSamples / 2; i++)
-		{
-			if (_vReal[i] > powf(NOISE_CUTOFF, gLogScale))
-			{
-				int freq = BucketFrequency(i);
-
-				int iBand = 0;
-				while (iBand < _BandCount)
-				{
-					if (freq < BandCutoffTable(_BandCount)[iBand])
-						break;
-					iBand++;
-				}
-				if (iBand > _BandCount)
-					iBand = _BandCount;
-
-				float scaledValue = _vReal[i];
-				if (scaledValue > _vPeaks[iBand])
-					_vPeaks[iBand] = scaledValue;
-			}
-		}
-
-		#if PRINT_PEAKS			
-		Serial.print("Raws:  ");
-		for (int i = 0; i < _BandCount; i++)
-		{
-			Serial.printf("%8.1f, ", _vPeaks[i]);
-		}
-		Serial.println("");
-		#endif
-   
-        // HACKHACK (davepl) 
-		//
-		// Egregious hand-tuning of the spectrum, these simply make the response look more linear to pink noise
-
-        if (_BandCount == 16 && gVU > (MAX_VU / 8))
-        {
-		    _vPeaks[0] *= 0.3f;											// Bring down the low bass a little bit
-		    _vPeaks[1] *= 0.6f;
-		    _vPeaks[2] *= 0.8f;
-			// ...
-            _vPeaks[9]  *= 1.10f;
-            _vPeaks[10] *= 1.25f;
-            _vPeaks[11] *= 1.40f;
-            _vPeaks[12] *= 1.60f;
-            _vPeaks[13] *= 1.80f;
-            _vPeaks[14] *= 1.90f;
-            _vPeaks[15] *= 2.00f;
-        }
-
-        // First we're going to scale our data up exponentially, then scale it down linearly, which should give us a logrithmic (or exponential?) display
-
-		for (int i = 0; i < _BandCount; i++)
-			_vPeaks[i] = powf(_vPeaks[i], gLogScale);
-
-		// All Bands Peak is the peak across every band; it's the "TOP" value that we must scale the entire display to fit
-
-		static float lastAllBandsPeak = 0.0f;
-		float allBandsPeak = 0;
-		for (int i = 0; i < _BandCount; i++)
-			allBandsPeak= max(allBandsPeak, _vPeaks[i]);
-		
-		if (allBandsPeak < 1)
-			allBandsPeak = 1;
-		
-		// The followinf picks allBandsPeak if it's gone up.  If it's gone down, it "averages" it by faking a running average of GAIN_DAMPEN past peaks
-
-		allBandsPeak = max(allBandsPeak, ((lastAllBandsPeak * (GAIN_DAMPEN-1)) + allBandsPeak) / GAIN_DAMPEN);	// Dampen rate of change a little bit on way down
-		lastAllBandsPeak = allBandsPeak;
-
-		// Now scale everything so that the peak is at 1.0f and everything else is fractional relative to it.    We never go below a meximum
-		// gain (for example, 2^26) so that we don't amplify hiss and noise to the point it shows up on the display.
-
-		if (allBandsPeak < powf(2, 26))
-			allBandsPeak = powf(2, 26);
-
-		for (int i = 0; i < _BandCount; i++)
-			_vPeaks[i] /= (allBandsPeak * 1.1f);
-		gScaler = allBandsPeak;
-
-        #if PRINT_PEAKS
-		Serial.print("Aftr:  ");
-		for (int i = 0; i < _BandCount; i++)
-		{
-			Serial.printf("%8.1f, ", _vPeaks[i]);
-		}
-		Serial.println("");
-        #endif
-	}
-    
-    // SampleBuffer::GetBandPeaks
-    //
-    // Once the FFT processing is complete you can call this function to get a copy of what each of the
-    // peaks in the various bands is
-
-	PeakData GetBandPeaks()
-	{
-		PeakData data;
-		for (int i = 0; i < _BandCount; i++)
-			data.Peaks[i] = _vPeaks[i];
-		return data;
-	}
-
-};
-float      SampleBuffer::_oldVU;
-
-class SoundAnalyzer
-{
-  private:
-
-	hw_timer_t	  * _SamplerTimer = NULL;													// The timer which will first SAMPLING_FREQUENCY times per second (like 32000)
-	SampleBuffer    _bufferA;																// A front buffer and a back buffer
-	SampleBuffer	_bufferB;
-	unsigned int	_sampling_period_us = PERIOD_FROM_FREQ(SAMPLING_FREQUENCY);
-	uint8_t			_inputPin;																// Which hardware pin do we actually sample audio from?
-
-	static volatile SampleBuffer * _pIRQBuffer;												// Static because there is only one, and it lives at global scoope	
-																							//  Volatile because the IRQ code could touch it when you're not paying attention
-  public:
-
-	SoundAnalyzer(uint8_t inputPin)
-		: _bufferA(MAX_SAMPLES, BAND_COUNT, SAMPLING_FREQUENCY, INPUT_PIN),
-		  _bufferB(MAX_SAMPLES, BAND_COUNT, SAMPLING_FREQUENCY, INPUT_PIN),
- 		  _sampling_period_us(PERIOD_FROM_FREQ(SAMPLING_FREQUENCY)),
-		  _inputPin(inputPin)
-	{
-		_pIRQBuffer = &_bufferA;
-	}
-
-	// SoundAnalyzer::StartInterrupts
-    //
-    // Sets a time interrupt to fire every _Samping_period_us (in microseconds).  The timers run on an 80MHz clock
-    // so the scale that down to 1M per second (microseconds).  
-
-    void StartInterrupts()
-	{
-		Serial.printf("Continual sampling every %d us for a sample rate of %d Hz.\n", _sampling_period_us, SAMPLING_FREQUENCY);
-
-		// Timer interrupt
-		_SamplerTimer = timerBegin(0, 80, true);					// Scalar for 80Mhz 
-		timerAttachInterrupt(_SamplerTimer, &OnTimer, true);		// Set callback
-		timerAlarmWrite(_SamplerTimer, _sampling_period_us, true);	// Set number of 1MHz events to fire upon and set reload == true
-		timerAlarmEnable(_SamplerTimer);
-	}
-
-	static void IRAM_ATTR OnTimer();
-
-    // ScanInputs
-    //
-    // With interrupts DISABED, quickly checks the input pots and records the value.  Not the greatest design to have the sound ananlyzer
-    // doing the user input, but only it knows when it's safe and that reading from the pot won't collide with an interrupt read
-
-    void ScanInputs()
-    {
-        analogSetSamples(1);                                // Otherwise voltage sweeps through range twice
-		float raw = analogRead(BRIGHTNESS_PIN);				// Brightness is logrithmic, so we do the opposite
-		raw = mapFloat(raw, 0, 4096, 1.5, 10);
-		raw = roundf(raw);
-		gBrightness = std::min(255.0f,powf(raw, 2.52f));
-
-        raw = analogRead(COLOR_SPEED_PIN);
-        raw = mapFloat(raw, 0, 4096, 0, MAX_COLOR_SPEED);
-        gColorSpeed = raw;
-
-        
-        // Peak delay for white lines.  When set all the way up to PEAK2_DECAY_PER_SECOND, they'll seem to be stuck
-        // to the top of the bars.  At zero the float, in between they fall.  Below zero is just how we convey
-        // "don't draw them at all".  So you can dial in -0.5 to 2.2 for example, and below 0 is OFF.
-
-        raw = analogRead(PEAK_DECAY_PIN);
-        raw = mapFloat(raw, 0, 4096, -0.5f, PEAK2_DECAY_PER_SECOND);
-        gPeakDecay = raw;
-
-        raw = analogRead(COLOR_SCHEME_PIN);
-        raw = mapFloat(raw, 0, 4096, 0, ARRAYSIZE(allPalettes));
-        giColorScheme = raw;
-
-        analogSetSamples(SUPERSAMPLES);
-    }
-
-    // RunSamplerPass
-    //
-    // Swap the front and rear buffers then run the FFT
-
-    PeakData RunSamplerPass(int bandCount)
-	{
-		SampleBuffer * pBackBuffer = nullptr;
-
-		for (;;)
-		{
-			if (_bufferA._cSamples == MAX_SAMPLES)
-			{
-				portDISABLE_INTERRUPTS();
-                ScanInputs();
-				_bufferB.Reset();
-				_pIRQBuffer = &_bufferB;
-				pBackBuffer = &_bufferA;
-				portENABLE_INTERRUPTS();
-				break;
-			}
-			if (_bufferB._cSamples == MAX_SAMPLES)
-			{
-				portDISABLE_INTERRUPTS();
-                ScanInputs();
-				_bufferA.Reset();
-				_pIRQBuffer = &_bufferA;
-				pBackBuffer = &_bufferB;
-				portENABLE_INTERRUPTS();
-				break;
-			}
-			delay(0);
-		}
-
-		pBackBuffer->WaitForLock();
-    	    pBackBuffer->FFT();
-		    pBackBuffer->ProcessPeaks();
-		    PeakData peaks = pBackBuffer->GetBandPeaks();
-		    pBackBuffer->Reset();
-		pBackBuffer->ReleaseLock();
-
-		return peaks;
-	}
-};
-
-volatile SampleBuffer * SoundAnalyzer::_pIRQBuffer;
-
-void IRAM_ATTR SoundAnalyzer::OnTimer()
-{
-    ((SampleBuffer *)_pIRQBuffer)->AcquireSample();         // Can't call through a volatile pointer directly
-}
-
-// The globlal instance of the SoundAnalyzer
-
-SoundAnalyzer g_SoundAnalyzer(INPUT_PIN);
-
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        SoundAnalyzer.h 
+//
+// Description:
+//
+//   Interrupt driven code that samples at (for example) 36000Hz on a timer
+//   IRQ.  
+//
+// History:     Sep-12-2018         Davepl      Commented
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+const size_t    MAX_SAMPLES		   = 512;
+const size_t    SAMPLING_FREQUENCY = 25000;
+const size_t    SAMPLE_RING_SIZE   = MAX_SAMPLES * 4;								// Power of 2; how far the sampler can fall behind before samples are lost
+const size_t    FFT_HOP			   = MAX_SAMPLES / FFT_OVERLAP;						// New samples between the starts of successive FFT windows
+const size_t    BASS_FILTER_TAPS   = 128;											// Length of the anti-alias filter ahead of the bass FFT
+const TickType_t SAMPLER_WAIT_MS   = 10;											// Longest the sampler sleeps without hearing from the IRQ
+
+static_assert(FFT_OVERLAP >= 1 && MAX_SAMPLES % FFT_OVERLAP == 0, "FFT_OVERLAP has to divide MAX_SAMPLES evenly");
+
+#define PRINT_PEAKS				0
+
+// SampleBuffer
+//
+// Holds one FFT window of samples.  The timer IRQ drops raw samples into the SoundAnalyzer's SampleRing, and
+// whenever a full window's worth has piled up the sampler calls LoadSamples() to pull them in, then FFT() and
+// ProcessPeaks(), and then GetBandPeaks() will return a set of peaks, one per band, from that sample data.
+//
+// The bass bands are too narrow for the full rate FFT's bins, so unless BASS_DECIMATION is 1 every new sample also
+// goes through a Decimator, and FFT() runs a second transform of the same size over its output.  That one spans
+// BASS_DECIMATION times as long with bins that much narrower, and the bands at or below BASS_CROSSOVER take their
+// peaks from it instead.  Both transforms are the same size and window, so their magnitudes are directly comparable.
+//
+// To maintain a continuous flow of samples (ABC - Always Be Crunching) the IRQ keeps filling the ring while we
+// crunch the window we have.  Only the sampler task ever touches a SampleBuffer, so it needs no lock.  Samples wait
+// in the ring as raw 16 bit ADC readings and are only converted to the engine's sample type as LoadSamples pulls
+// them into the window, which is the buffer's own, so buffers on different sampler tasks never share one.
+//
+// The band count is a template parameter so that every per-band loop has a trip count the compiler knows, and the
+// band layout for it comes from BandLayout.h.
+//
+// So is the channel count.  The ring hands over each channel's window one after another rather than interleaved,
+// so every stage from windowing to the band peaks walks one contiguous run per channel, with the same loop for all
+// of them.  Each channel gets its own peaks and VU, but the auto gain is shared so that their levels stay comparable.
+// With two or more channels, SetMidSide turns the first two from left and right into mid (L+R)/2 and side (L-R)/2.
+
+template <size_t BandCount, size_t Channels = 1>
+class SampleBuffer
+{
+  private:
+	typedef BandLayout<BandCount> Layout;
+
+	static constexpr size_t BassBandCount = BASS_DECIMATION > 1 ? Layout::BandsBelow(BASS_CROSSOVER) : 0;	// Bands 0..BassBandCount-1 come from the decimated FFT
+
+	FFTEngine		  _FFT;                 // Whichever engine FFT_ENGINE selects; see FFTEngine.h
+	size_t            _MaxSamples;          // Number of samples we will take, must be a power of 2
+	size_t            _SamplingFrequency;   // Sampling Frequency should be at least twice that of highest freq sampled
+	float			  _vPeaks[Channels][BandCount];
+	uint16_t		  _vBandStart[BandCount + 1];		// First FFT bin of each band, plus one past the last band's last bin
+	Decimator		* _vDecimators[Channels];	// Only there if we have bass bands
+	FFTEngine::Sample * _vBassReal;			// Decimated samples in, magnitudes out, a window per channel; the second half of the allocation
+	uint16_t		  _vBassBandStart[BassBandCount + 1];	// Like _vBandStart, but bins of the decimated FFT
+	float			  _vBandGain[BandCount];	// Equalization, so that pink noise comes out flat
+	float			  _noiseCutoff;			// Bins at or below this are ignored; follows gLogScale
+	float			  _noiseLogScale;		// The gLogScale that _noiseCutoff was computed for
+	size_t			  _HopSize;				// New samples per frame; less than _MaxSamples when the windows overlap
+	unsigned long	  _windowTime;			// micros() when the newest sample in the window was taken
+	size_t			  _decimated;			// How many frames at the start of the ring's next window the decimators already have
+	float			  _vuDecay;				// How much of the old VU and auto gain survive each frame, scaled
+	float			  _gainDecay;			//   to the hop so they react at the same speed whatever the overlap
+	float			  _vu[Channels];		// Smoothed VU level of each channel as of the last frame
+	float			  _scaler;				// Auto gain as of the last frame: what the loudest band of any channel is scaled down by
+	bool			  _midSide;				// Turn channels 0 and 1 from left and right into mid and side as they come in
+	float			  _lastAllBandsPeak;	// The auto gain before the floor was applied, which is what decays
+
+	static const int  NOISE_CUTOFF = 10;
+
+	// BucketFrequency
+	//
+	// Return the frequency corresponding to the Nth sample bucket.  Skips the first two 
+	// buckets which are overall amplitude and something else.
+
+	int BucketFrequency(int iBucket) const
+	{
+		if (iBucket <= 1)
+			return 0;
+
+		int iOffset = iBucket - 2;
+		return iOffset * (_SamplingFrequency / 2) / (_MaxSamples / 2);
+	}
+
+	// BuildBandMap
+	//
+	// Works out once which run of FFT bins lands in each band, so that ProcessPeaks doesn't have to search the
+	// cutoff table for every bin of every frame.  Bins are assigned just as they always were: a bin belongs to
+	// the first band whose cutoff is above the bin's frequency, and bins above the top cutoff aren't in any band.
+
+	void BuildBandMap()
+	{
+		size_t iBin = 2;
+		for (size_t iBand = 0; iBand < BandCount; iBand++)
+		{
+			_vBandStart[iBand] = iBin;
+			while (iBin < _MaxSamples / 2 && BucketFrequency(iBin) < Layout::Cutoffs[iBand])
+				iBin++;
+		}
+		_vBandStart[BandCount] = iBin;
+	}
+
+	// BuildBassBandMap
+	//
+	// Same idea for the decimated FFT, whose bins are BASS_DECIMATION times narrower.  Its bins start at DC rather
+	// than two bins below it, and DC itself is skipped.
+
+	void BuildBassBandMap()
+	{
+		const float binWidth = (float) _SamplingFrequency / BASS_DECIMATION / _MaxSamples;
+
+		size_t iBin = 1;
+		for (size_t iBand = 0; iBand < BassBandCount; iBand++)
+		{
+			_vBassBandStart[iBand] = iBin;
+			while (iBin < _MaxSamples / 2 && iBin * binWidth < Layout::Cutoffs[iBand])
+				iBin++;
+		}
+		_vBassBandStart[BassBandCount] = iBin;
+	}
+
+	// ExpectedPeak
+	//
+	// Roughly how big the biggest of a band's bins will be, on average, for a noise whose power goes as 1/f^tilt.
+	// Each bin's power is exponentially distributed around the noise's density times the bin width, and the
+	// expected max of j of those with the same mean is that mean times the jth harmonic number.  Taking the bins
+	// from loudest to quietest, the best of those estimates is close enough to line the bands up.
+
+	static float ExpectedPeak(size_t firstBin, size_t endBin, float binWidth, float firstBinFrequency)
+	{
+		const size_t count = endBin - firstBin;
+
+		float harmonic = 0.0f;
+		float best     = 0.0f;
+		for (size_t j = 1; j <= count; j++)
+		{
+			size_t iBin = (BAND_EQ_TILT >= 0) ? firstBin + j - 1 : endBin - j;
+			float  hz   = std::max(binWidth / 2, firstBinFrequency + (iBin - firstBin) * binWidth);
+
+			harmonic += 1.0f / j;
+			best = std::max(best, powf(hz, -BAND_EQ_TILT) * binWidth * harmonic);
+		}
+		return sqrtf(best);
+	}
+
+	// BuildEqualizer
+	//
+	// Works out a gain for each band so that pink noise (or whatever BAND_EQ_TILT describes) lights every band to
+	// the same height.  The gains undo each band's expected peak, which depends on where it sits in the spectrum,
+	// how wide its bins are and how many of them it has, and are normalized to a geometric mean of one so the
+	// overall level doesn't move.  If BAND_EQ_GAINS is defined for this band count, the calibration tool's
+	// measured gains are used instead.
+	//
+	// The hand tuning this replaced only kicked in once gVU passed MAX_VU/8.  The EQ applies at every level instead,
+	// so quiet passages are balanced the same as loud ones and the bars don't jump as the level crosses that line.
+
+	void BuildEqualizer()
+	{
+		const float binWidth     = (float) _SamplingFrequency / _MaxSamples;
+		const float bassBinWidth = binWidth / BASS_DECIMATION;
+
+		float logSum = 0.0f;
+		int	  used   = 0;
+		for (size_t iBand = 0; iBand < BandCount; iBand++)
+		{
+			float expected = (iBand < BassBandCount)
+						   ? ExpectedPeak(_vBassBandStart[iBand], _vBassBandStart[iBand + 1], bassBinWidth, _vBassBandStart[iBand] * bassBinWidth)
+						   : ExpectedPeak(_vBandStart[iBand], _vBandStart[iBand + 1], binWidth, _vBandStart[iBand] * binWidth);
+
+			_vBandGain[iBand] = expected > 0 ? 1.0f / expected : 0.0f;
+			if (expected > 0)
+			{
+				logSum += logf(_vBandGain[iBand]);
+				used++;
+			}
+		}
+
+		const float normalize = used ? expf(-logSum / used) : 1.0f;
+		for (size_t iBand = 0; iBand < BandCount; iBand++)
+			_vBandGain[iBand] = _vBandGain[iBand] > 0 ? _vBandGain[iBand] * normalize : 1.0f;
+
+		#ifdef BAND_EQ_GAINS
+		static const float calibrated[] = { BAND_EQ_GAINS };
+		if (ARRAYSIZE(calibrated) == BandCount)
+			for (size_t iBand = 0; iBand < BandCount; iBand++)
+				_vBandGain[iBand] = calibrated[iBand];
+		#endif
+	}
+
+	// BandPeaks
+	//
+	// Each band's peak is a max over its own contiguous run of bins, with anything under the noise floor counting
+	// as zero, times the band's EQ gain.  vData holds a window per channel, back to back.
+
+	void BandPeaks(const FFTEngine::Sample * vData, const uint16_t * vBandStart, size_t firstBand, size_t endBand)
+	{
+		const float noiseCutoff = _noiseCutoff;
+		for (size_t c = 0; c < Channels; c++)
+		{
+			const FFTEngine::Sample * vChannel = vData + c * _MaxSamples;
+			for (size_t iBand = firstBand; iBand < endBand; iBand++)
+			{
+				float peak = 0.0f;
+				for (size_t i = vBandStart[iBand]; i < vBandStart[iBand + 1]; i++)
+				{
+					float value = vChannel[i];
+					peak = std::max(peak, value > noiseCutoff ? value : 0.0f);
+				}
+				_vPeaks[c][iBand] = peak * _vBandGain[iBand];
+			}
+		}
+	}
+
+	// RemoveDC
+	//
+	// Takes a main window's mean out of it ahead of the engine, whichever engine it is.  The ADC idles at its
+	// midpoint, so without the bass FFT band 0 would take that DC and its window leakage, and the fixed point
+	// engines would block scale to the DC and leave the audio a few bits at the bottom of the word.  The bass
+	// windows come out of the decimator's DC blocker instead; a mean taken over their few cycles of a low tone
+	// would only put some of the tone into band 0.
+
+	void RemoveDC(FFTEngine::Sample * vData)
+	{
+		FFTEngine::Sample sum = 0;
+		for (size_t i = 0; i < _MaxSamples; i++)
+			sum += vData[i];
+
+		const FFTEngine::Sample mean = sum / _MaxSamples;
+		for (size_t i = 0; i < _MaxSamples; i++)
+			vData[i] -= mean;
+	}
+
+	// SplitMidSide
+	//
+	// Replaces the left and right runs of count samples, channels 0 and 1, with their mid and side
+
+	void SplitMidSide(size_t count)
+	{
+		FFTEngine::Sample * vLeft  = _vReal;
+		FFTEngine::Sample * vRight = _vReal + count;
+		for (size_t i = 0; i < count; i++)
+		{
+			FFTEngine::Sample left = vLeft[i], right = vRight[i];
+			vLeft[i]  = (left + right) / 2;
+			vRight[i] = (left - right) / 2;
+		}
+	}
+
+	FFTEngine::Sample * _vReal;				// Samples in, magnitudes out, a window per channel; audio is real so there's no imaginary half
+	size_t				_windowSamples;		// Length of the allocation _vReal and _vBassReal share
+
+  public:
+
+	SampleBuffer(size_t MaxSamples, size_t SamplingFrequency)
+		: _FFT(MaxSamples)
+	{
+		_SamplingFrequency = SamplingFrequency;
+		_MaxSamples        = MaxSamples;
+
+		_noiseLogScale	   = NAN;
+		_noiseCutoff	   = 0.0f;
+		_scaler			   = 0.0f;
+		_midSide		   = false;
+		_lastAllBandsPeak  = 0.0f;
+		_windowTime		   = 0;
+		_decimated		   = 0;
+
+		SetHopSize(MaxSamples);
+
+		BuildBandMap();
+
+		// Bass bands are the ones entirely below the crossover, which only makes sense if we're decimating
+
+		for (size_t c = 0; c < Channels; c++)
+		{
+			_vu[c]			= 0.0f;
+			_vDecimators[c] = nullptr;
+		}
+		if (BassBandCount > 0)
+		{
+			const float bassNyquist = SamplingFrequency / BASS_DECIMATION / 2.0f;
+			for (size_t c = 0; c < Channels; c++)
+				_vDecimators[c] = new Decimator(BASS_DECIMATION, BASS_FILTER_TAPS, bassNyquist * 0.7f, SamplingFrequency, MaxSamples);
+			BuildBassBandMap();
+		}
+		BuildEqualizer();
+
+		// One allocation holds every channel's window, followed by every channel's bass window if there are any
+
+		_windowSamples = Channels * (_vDecimators[0] ? MaxSamples * 2 : MaxSamples);
+		_vReal		   = (FFTEngine::Sample *) calloc(_windowSamples, sizeof(_vReal[0]));
+		_vBassReal	   = _vDecimators[0] ? _vReal + Channels * MaxSamples : nullptr;
+		Reset();
+	}
+	~SampleBuffer()
+	{
+		for (size_t c = 0; c < Channels; c++)
+			delete _vDecimators[c];
+		free(_vReal);
+	}
+
+	SampleBuffer(const SampleBuffer &) = delete;
+	SampleBuffer & operator=(const SampleBuffer &) = delete;
+
+    // SampleBuffer::Bytes
+    //
+    // Memory this buffer owns, not counting its windows, which WindowBytes reports, or the shared FFT tables
+
+	size_t Bytes() const
+	{
+		size_t bytes = sizeof(*this) + _FFT.Bytes();
+		for (size_t c = 0; c < Channels; c++)
+			bytes += _vDecimators[c] ? _vDecimators[c]->Bytes() : 0;
+		return bytes;
+	}
+
+	size_t WindowBytes() const
+	{
+		return _windowSamples * sizeof(_vReal[0]);
+	}
+
+    // SampleBuffer::Reset
+    //
+    // Clears the peaks.  The samples don't need clearing since LoadSamples overwrites every one of them.
+
+	void Reset()
+	{
+		for (size_t c = 0; c < Channels; c++)
+			for (size_t i = 0; i < BandCount; i++)
+				_vPeaks[c][i] = 0;
+	}
+
+    // SampleBuffer::SetMidSide
+    //
+    // With it on, channels 0 and 1 come out as mid and side instead of left and right.  The other channels, if
+    // there are any, are left alone.
+
+	void SetMidSide(bool midSide)
+	{
+		static_assert(Channels >= 2, "Mid and side need a left and a right");
+		_midSide = midSide;
+	}
+
+    // SampleBuffer::SetWindow
+    //
+    // Picks the window function applied ahead of the FFT.  The tables are level corrected, so the bands don't
+    // jump when this changes.
+
+	void SetWindow(FFTWindowType window)
+	{
+		_FFT.SetWindow(window);
+	}
+
+    // SampleBuffer::FFT
+    //
+    // Run the FFT on each channel's window.  When done the first two buckets are VU data and only the first MAX_SAMPLES/2
+    // are valid.  For each bucket afterwards you can call BucketFrequency to find out what freq corresponds to what bucket
+
+	void FFT()
+	{
+		TIME_STAGE(STAGE_FFT);
+
+		for (size_t c = 0; c < Channels; c++)
+		{
+			FFTEngine::Sample * vData = _vReal + c * _MaxSamples;
+			RemoveDC(vData);
+			_FFT.Windowing(vData);
+			_FFT.Compute(vData);
+			_FFT.ComplexToMagnitude(vData);
+		}
+
+		if (_vDecimators[0])
+		{
+			for (size_t c = 0; c < Channels; c++)
+			{
+				FFTEngine::Sample * vData = _vBassReal + c * _MaxSamples;
+				_vDecimators[c]->GetWindow(vData);
+				_FFT.Windowing(vData);
+				_FFT.Compute(vData);
+				_FFT.ComplexToMagnitude(vData);
+			}
+		}
+	}
+	
+    // SampleBuffer::SetHopSize
+    //
+    // Sets how many new samples each frame brings in.  Once per window's worth (no overlap) is what the VU and
+    // auto gain smoothing were tuned for: the VU keeps 3/4 of its old value per frame and the gain keeps
+    // (GAIN_DAMPEN-1)/GAIN_DAMPEN of it.  With overlap there are more frames per second, so each one keeps more.
+
+	void SetHopSize(size_t hopSize)
+	{
+		const float framesPerWindow = (float) _MaxSamples / hopSize;
+
+		_HopSize   = hopSize;
+		_vuDecay   = powf(3.0f / 4.0f, 1.0f / framesPerWindow);
+		_gainDecay = powf((GAIN_DAMPEN - 1) / (float) GAIN_DAMPEN, 1.0f / framesPerWindow);
+	}
+
+	size_t HopSize() const
+	{
+		return _HopSize;
+	}
+
+    // SampleBuffer::LoadSamples
+    //
+    // Converts the oldest full window of raw samples in the ring straight into the FFT buffer and consumes the
+    // first hop's worth of them; the rest stay in the ring to start the next window.  Returns how many frames were
+    // overwritten before we got to them, which should stay at zero unless the sampler task is starved for a ring's
+    // worth of samples.
+    //
+    // The decimators get every sample exactly once: the whole of the first window, and after that whatever part
+    // of each window the last one didn't cover, which with overlap is its final hop.
+
+	size_t LoadSamples(ChannelRing<Channels> & ring)
+	{
+		TIME_STAGE(STAGE_LOAD_SAMPLES);
+
+		size_t lost = ring.Read(_vReal, _MaxSamples, _HopSize);
+		if (Channels >= 2 && _midSide)
+			SplitMidSide(_MaxSamples);
+
+		// Whatever is still in the ring past the end of our window came in after its newest sample
+
+		size_t newer = ring.Available() - std::min(ring.Available(), _MaxSamples - _HopSize);
+		_windowTime  = micros() - (unsigned long)(newer * 1000000ull / _SamplingFrequency);
+
+		if (lost)
+			_decimated = 0;												// The window doesn't follow on from the last one
+		if (_vDecimators[0])
+			for (size_t c = 0; c < Channels; c++)
+				_vDecimators[c]->Process(_vReal + c * _MaxSamples + _decimated, _MaxSamples - _decimated);
+		_decimated = _MaxSamples - _HopSize;
+		return lost;
+	}
+
+    // SampleBuffer::Skip
+    //
+    // Throws away the oldest count frames in the ring without analyzing them, for a sampler that has fallen behind.
+    // The ones the decimators haven't had yet still go through them, a window's length at a time through the FFT
+    // buffer, since their filters need an unbroken signal.  Returns how many frames were overwritten before we got
+    // to them, in which case the ring has moved on past everything we were skipping.
+
+	size_t Skip(ChannelRing<Channels> & ring, size_t count)
+	{
+		const size_t decimated = std::min(_decimated, count);
+		ring.Skip(decimated);
+		_decimated -= decimated;
+		count	   -= decimated;
+
+		if (!_vDecimators[0])
+		{
+			ring.Skip(count);
+			return 0;
+		}
+
+		while (count > 0)
+		{
+			const size_t chunk = std::min(count, _MaxSamples);
+			const size_t lost  = ring.Read(_vReal, chunk, chunk);
+			if (lost)
+			{
+				_decimated = 0;
+				return lost;
+			}
+			if (Channels >= 2 && _midSide)
+				SplitMidSide(chunk);
+			for (size_t c = 0; c < Channels; c++)
+				_vDecimators[c]->Process(_vReal + c * chunk, chunk);
+			count -= chunk;
+		}
+		return 0;
+	}
+
+    // SampleBuffer::VU, SampleBuffer::Scaler
+    //
+    // A channel's VU level and the auto gain after the last frame, for whoever publishes them to gVU and gScaler
+
+	float VU(size_t channel = 0) const
+	{
+		return _vu[channel];
+	}
+
+	float Scaler() const
+	{
+		return _scaler;
+	}
+
+    // SampleBuffer::BandGain
+    //
+    // The EQ gain applied to a band, for the calibration tool
+
+	float BandGain(size_t iBand) const
+	{
+		return _vBandGain[iBand];
+	}
+
+    // SampleBuffer::BandRange
+    //
+    // The span of frequencies, in Hz, whose bins make up a band, from the bottom edge of its first bin to the bottom
+    // edge of the next band's.  Bin k sits at k bin widths; BucketFrequency's offset only decides where the cutoffs
+    // fall.  Empty bands come back with low == high.
+
+	void BandRange(size_t iBand, float & low, float & high) const
+	{
+		const bool	   bass	    = iBand < BassBandCount;
+		const uint16_t * vStart = bass ? _vBassBandStart : _vBandStart;
+		const float	   binWidth = (float) _SamplingFrequency / _MaxSamples / (bass ? BASS_DECIMATION : 1);
+
+		low	 = (vStart[iBand] - 0.5f) * binWidth;
+		high = (vStart[iBand + 1] - 0.5f) * binWidth;
+	}
+
+    // SampleBuffer::ProcessPeaks
+    //
+    // Runs through and figures out what the peak level is in each of the bands.  Also calculates
+    // the overall VU level and adjusts the auto gain.
+
+	void ProcessPeaks()
+	{
+		TIME_STAGE(STAGE_PROCESS_PEAKS);
+
+		MeasureBands();
+		ScaleBands();
+	}
+
+    // SampleBuffer::MeasureBands
+    //
+    // The first half of ProcessPeaks: each channel's VU level and equalized band peaks, before any scaling
+
+	void MeasureBands()
+	{
+		for (size_t c = 0; c < Channels; c++)
+		{
+			const FFTEngine::Sample * vChannel = _vReal + c * _MaxSamples;
+
+			float averageSum = 0.0f;
+			for (size_t i = 2; i < _MaxSamples / 2; i++)
+				averageSum += vChannel[i];
+
+			float t = averageSum / (_MaxSamples / 2);
+			_vu[c] = max(t, _vu[c] * _vuDecay + t * (1.0f - _vuDecay));
+		}
+
+		// The noise floor only needs recomputing when someone moves gLogScale
+
+		float logScale = gLogScale;
+		if (logScale != _noiseLogScale)
+		{
+			_noiseLogScale = logScale;
+			_noiseCutoff   = powf(NOISE_CUTOFF, logScale);
+		}
+
+		if (BassBandCount > 0)
+			BandPeaks(_vBassReal, _vBassBandStart, 0, BassBandCount);
+		BandPeaks(_vReal, _vBandStart, BassBandCount, BandCount);
+
+		#if PRINT_PEAKS			
+		for (size_t c = 0; c < Channels; c++)
+		{
+			Serial.print("Raws:  ");
+			for (size_t i = 0; i < BandCount; i++)
+			{
+				Serial.printf("%8.1f, ", _vPeaks[c][i]);
+			}
+			Serial.println("");
+		}
+		#endif
+	}
+
+    // SampleBuffer::ScaleBands
+    //
+    // The second half of ProcessPeaks: shapes the band peaks for display and applies the auto gain
+
+	void ScaleBands()
+	{
+        // First we're going to scale our data up exponentially, then scale it down linearly, which should give us a logrithmic (or exponential?) display
+
+		const float logScale = gLogScale;
+		for (size_t c = 0; c < Channels; c++)
+			for (size_t i = 0; i < BandCount; i++)
+				_vPeaks[c][i] = powf(_vPeaks[c][i], logScale);
+
+		// All Bands Peak is the peak across every band of every channel; it's the "TOP" value that we must scale the entire display to fit
+
+		float allBandsPeak = 0;
+		for (size_t c = 0; c < Channels; c++)
+			for (size_t i = 0; i < BandCount; i++)
+				allBandsPeak= max(allBandsPeak, _vPeaks[c][i]);
+		
+		if (allBandsPeak < 1)
+			allBandsPeak = 1;
+		
+		// The followinf picks allBandsPeak if it's gone up.  If it's gone down, it "averages" it by faking a running average of GAIN_DAMPEN past peaks
+
+		allBandsPeak = max(allBandsPeak, _lastAllBandsPeak * _gainDecay + allBandsPeak * (1.0f - _gainDecay));	// Dampen rate of change a little bit on way down
+		_lastAllBandsPeak = allBandsPeak;
+
+		// Now scale everything so that the peak is at 1.0f and everything else is fractional relative to it.    We never go below a meximum
+		// gain (for example, 2^26) so that we don't amplify hiss and noise to the point it shows up on the display.
+
+		if (allBandsPeak < powf(2, 26))
+			allBandsPeak = powf(2, 26);
+
+		for (size_t c = 0; c < Channels; c++)
+			for (size_t i = 0; i < BandCount; i++)
+				_vPeaks[c][i] /= (allBandsPeak * 1.1f);
+		_scaler = allBandsPeak;
+
+        #if PRINT_PEAKS
+		for (size_t c = 0; c < Channels; c++)
+		{
+			Serial.print("Aftr:  ");
+			for (size_t i = 0; i < BandCount; i++)
+			{
+				Serial.printf("%8.1f, ", _vPeaks[c][i]);
+			}
+			Serial.println("");
+		}
+        #endif
+	}
+    
+    // SampleBuffer::GetBandPeaks
+    //
+    // Once the FFT processing is complete you can call this function to get a copy of what each of the
+    // peaks in the various bands is, for one channel
+
+	PeakData<BandCount> GetBandPeaks(size_t channel = 0)
+	{
+		PeakData<BandCount> data;
+		for (size_t i = 0; i < BandCount; i++)
+			data.Peaks[i] = _vPeaks[channel][i];
+		data.Timestamp = _windowTime;
+		return data;
+	}
+
+};
+
+template <size_t Channels> class SampleSource;
+
+// MultiChannelAnalyzer
+//
+// Turns the frames a SampleSource delivers, one sample per channel in each, into band peaks, a set per channel.
+// The source pushes into the analyzer's ring from its ISR or its own task, and the sampler task pulls windows out
+// of it.  Each analyzer has its own ring, SampleBuffer and statistics, so there can be several, say one per timer
+// driven source, and each can be run from a sampler task of its own.
+
+template <size_t Channels>
+class MultiChannelAnalyzer
+{
+  private:
+
+	ChannelRing<Channels> _ring;															// Raw samples from the source, waiting to be crunched
+	SampleBuffer<BAND_COUNT, Channels> _buffer;												// The windows we're crunching
+	SampleSource<Channels> * _pSource = nullptr;											// Whoever is delivering to us, if anyone
+	TaskHandle_t volatile _samplerTask = nullptr;											// Task the source wakes each time a hop's worth of samples is in
+	size_t volatile	_notifyEvery = FFT_HOP;
+	SampleStatistics _stats;																// What our source and sampler pass have seen
+
+  public:
+
+	MultiChannelAnalyzer()
+		: _ring(SAMPLE_RING_SIZE),
+		  _buffer(MAX_SAMPLES, SAMPLING_FREQUENCY)
+	{
+		_buffer.SetHopSize(FFT_HOP);
+	}
+
+	~MultiChannelAnalyzer()
+	{
+		Stop();
+	}
+
+	MultiChannelAnalyzer(const MultiChannelAnalyzer &) = delete;
+	MultiChannelAnalyzer & operator=(const MultiChannelAnalyzer &) = delete;
+
+	// MultiChannelAnalyzer::Stats, MultiChannelAnalyzer::VU, MultiChannelAnalyzer::Scaler
+	//
+	// This analyzer's sample counts, and a channel's VU level and the shared auto gain as of its last pass
+
+	const SampleStatistics & Stats() const
+	{
+		return _stats;
+	}
+
+	float VU(size_t channel = 0) const
+	{
+		return _buffer.VU(channel);
+	}
+
+	float Scaler() const
+	{
+		return _buffer.Scaler();
+	}
+
+	// MultiChannelAnalyzer::SetMidSide
+	//
+	// Reports channels 0 and 1 as mid and side rather than left and right
+
+	void SetMidSide(bool midSide)
+	{
+		_buffer.SetMidSide(midSide);
+	}
+
+	// MultiChannelAnalyzer::Start, MultiChannelAnalyzer::Stop
+	//
+	// Connects a source and has it start delivering, or stops it and lets it go.  One source at a time.
+
+	bool Start(SampleSource<Channels> & source)
+	{
+		Stop();
+		if (!source.Start(*this))
+			return false;
+		_pSource = &source;
+		return true;
+	}
+
+	void Stop()
+	{
+		if (!_pSource)
+			return;
+		_pSource->Stop();
+		_pSource = nullptr;
+	}
+
+	// MultiChannelAnalyzer::SetOverlap
+	//
+	// How many FFTs to run per window's worth of new samples: 1 for back to back windows, 2 for 50% overlap, 4 for
+	// 75%.  More overlap means fresh peaks more often at the same frequency resolution, for more CPU.  Returns false
+	// and leaves the overlap alone unless it divides MAX_SAMPLES evenly.
+
+	bool SetOverlap(size_t overlap)
+	{
+		if (overlap < 1 || MAX_SAMPLES % overlap)
+			return false;
+
+		const size_t hopSize = MAX_SAMPLES / overlap;
+		_buffer.SetHopSize(hopSize);
+		_notifyEvery = hopSize;
+		return true;
+	}
+
+	// MultiChannelAnalyzer::SetSamplerTask
+	//
+	// The task that calls RunSamplerPass.  Once it's set, the source notifies it every time a hop's worth of new
+	// samples has come in, and RunSamplerPass sleeps until then rather than polling.
+
+	void SetSamplerTask(TaskHandle_t task)
+	{
+		_samplerTask = task;
+	}
+
+	// MultiChannelAnalyzer::Deliver
+	//
+	// A timer driven source's ISR calls here with each frame.  Never waits and never drops: just a store and an index
+	// bump, plus a nudge to the sampler task at the end of every hop.
+
+	inline void Deliver(const uint16_t (&frame)[Channels]) __attribute__((always_inline))
+	{
+		_stats.CountDelivered(1);
+		uint32_t pushed = _ring.Push(frame);
+
+		TaskHandle_t samplerTask = _samplerTask;
+		if (samplerTask && pushed % _notifyEvery == 0)
+		{
+			BaseType_t woken = pdFALSE;
+			vTaskNotifyGiveFromISR(samplerTask, &woken);
+			if (woken)
+				portYIELD_FROM_ISR();
+		}
+	}
+
+	// MultiChannelAnalyzer::Deliver
+	//
+	// Block sources call here, from a task rather than an ISR, with count interleaved frames at once.  The nudge
+	// goes out once if the block finished a hop, however many it finished.
+
+	void Deliver(const uint16_t * pFrames, size_t count)
+	{
+		_stats.CountDelivered(count);
+		uint32_t pushed = _ring.Push(pFrames, count);
+
+		TaskHandle_t samplerTask = _samplerTask;
+		if (samplerTask && pushed / _notifyEvery != (pushed - count) / _notifyEvery)
+			xTaskNotifyGive(samplerTask);
+	}
+
+	// MultiChannelAnalyzer::Ready
+	//
+	// Whether there's a full window waiting, so that RunSamplerPass won't have to wait for one
+
+	bool Ready() const
+	{
+		return _ring.Available() >= MAX_SAMPLES;
+	}
+
+	// MultiChannelAnalyzer::MemoryReport
+	//
+	// Prints where the analyzer's memory goes.  For comparison, the last line is what the SampleBuffers would
+	// need if every channel of each still kept its own double precision window with an imaginary half alongside.
+
+	void MemoryReport()
+	{
+		const size_t ring	 = _ring.Bytes();
+		const size_t buffer	 = _buffer.Bytes();
+		const size_t windows = _buffer.WindowBytes();
+		const size_t tables	 = FFTTableBytes();
+
+		Serial.printf("%-28s %8s\n", "Memory", "Bytes");
+		Serial.printf("%-28s %8u  %u raw samples from %s\n", "Sample ring", (unsigned) ring, (unsigned)(_ring.Capacity() * Channels), _pSource ? _pSource->Name() : "no source");
+		Serial.printf("%-28s %8u  %s engine and decimator\n", "SampleBuffer", (unsigned) buffer, FFTEngine::Name());
+		Serial.printf("%-28s %8u  %u channel%s\n", "FFT windows", (unsigned) windows, (unsigned) Channels, Channels == 1 ? "" : "s");
+		Serial.printf("%-28s %8u  shared by all engines\n", "FFT tables", (unsigned) tables);
+		Serial.printf("%-28s %8u\n", "Total", (unsigned)(ring + buffer + windows + tables));
+		Serial.printf("%-28s %8u\n", "Double re+im per channel", (unsigned)(Channels * MAX_SAMPLES * 2 * sizeof(double)));
+	}
+
+    // ScanInputs
+    //
+    // With interrupts DISABED, quickly checks the input pots and records the value.  Not the greatest design to have the sound ananlyzer
+    // doing the user input, but only it knows when it's safe and that reading from the pot won't collide with an interrupt read
+
+    void ScanInputs()
+    {
+        analogSetSamples(1);                                // Otherwise voltage sweeps through range twice
+		float raw = analogRead(BRIGHTNESS_PIN);				// Brightness is logrithmic, so we do the opposite
+		raw = mapFloat(raw, 0, 4096, 1.5, 10);
+		raw = roundf(raw);
+		gBrightness = std::min(255.0f,powf(raw, 2.52f));
+
+        raw = analogRead(COLOR_SPEED_PIN);
+        raw = mapFloat(raw, 0, 4096, 0, MAX_COLOR_SPEED);
+        gColorSpeed = raw;
+
+        
+        // Peak delay for white lines.  When set all the way up to PEAK2_DECAY_PER_SECOND, they'll seem to be stuck
+        // to the top of the bars.  At zero the float, in between they fall.  Below zero is just how we convey
+        // "don't draw them at all".  So you can dial in -0.5 to 2.2 for example, and below 0 is OFF.
+
+        raw = analogRead(PEAK_DECAY_PIN);
+        raw = mapFloat(raw, 0, 4096, -0.5f, PEAK2_DECAY_PER_SECOND);
+        gPeakDecay = raw;
+
+        raw = analogRead(COLOR_SCHEME_PIN);
+        raw = mapFloat(raw, 0, 4096, 0, ARRAYSIZE(allPalettes));
+        giColorScheme = raw;
+
+        analogSetSamples(SUPERSAMPLES);
+    }
+
+    // RunSamplerPass
+    //
+    // Wait for a full window to pile up in the ring, pull it out and run the FFTs on it, leaving each channel's
+    // peaks in its own PeakData.  The wait is on the source's notification; the timeout is only a backstop in case
+    // the windows and the notifications fall out of step.
+
+    void RunSamplerPass(PeakData<BAND_COUNT> (&peaks)[Channels])
+	{
+		// If we've fallen more than a hop behind, skip the stale hops rather than showing old spectra late.  Should
+		// the source lap us while we skip, there's no telling how much is left, so wait and look again.
+
+		size_t hopSize = _buffer.HopSize();
+		size_t lost	   = 0;
+		for (;;)
+		{
+			while (_ring.Available() < MAX_SAMPLES)
+				ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SAMPLER_WAIT_MS));
+
+			size_t backlog = _ring.Available() - MAX_SAMPLES;
+			if (backlog < hopSize)
+				break;
+			lost += _buffer.Skip(_ring, backlog - backlog % hopSize);
+		}
+
+		portDISABLE_INTERRUPTS();
+        ScanInputs();
+		portENABLE_INTERRUPTS();
+
+		_stats.CountSamples(hopSize, lost + _buffer.LoadSamples(_ring));
+		_buffer.FFT();
+		_buffer.ProcessPeaks();
+		for (size_t c = 0; c < Channels; c++)
+			peaks[c] = _buffer.GetBandPeaks(c);
+		_buffer.Reset();
+	}
+
+	PeakData<BAND_COUNT> RunSamplerPass()
+	{
+		static_assert(Channels == 1, "Pass an array with room for every channel's peaks");
+
+		PeakData<BAND_COUNT> peaks[1];
+		RunSamplerPass(peaks);
+		return peaks[0];
+	}
+
+	// MultiChannelAnalyzer::RunToEnd
+	//
+	// Runs a source that only delivers when pumped through the analyzer as fast as it will go, a hop at a time so
+	// that no window is ever skipped, handing each pass's peaks to onPeaks(peaks) until the source runs dry.  Returns
+	// how many passes there were.
+
+	template <typename Callback>
+	size_t RunToEnd(SampleSource<Channels> & source, Callback onPeaks)
+	{
+		if (!Start(source))
+			return 0;
+
+		PeakData<BAND_COUNT> peaks[Channels];
+		size_t passes = 0;
+		while (source.Pump(_buffer.HopSize()))
+		{
+			while (Ready())
+			{
+				RunSamplerPass(peaks);
+				onPeaks(peaks);
+				passes++;
+			}
+		}
+		Stop();
+		return passes;
+	}
+};
+
+// SoundAnalyzer
+//
+// The single channel analyzer the sketch runs
+
+typedef MultiChannelAnalyzer<1> SoundAnalyzer;
+
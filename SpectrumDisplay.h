@@ -1,222 +1,398 @@
-//+--------------------------------------------------------------------------
-//
-// SpectrumDisplayIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
-//
-// File:        SpectrumDisplay.h
-//
-// Description:
-//
-//   Spectrum analyzer display.  Draws the bands and the peak highlights
-//   and the VU meter.
-//
-// History:     Sep-12-2018         Davepl      Commented
-//
-//---------------------------------------------------------------------------
-
-#define PEAK2_DECAY_PER_SECOND  2.2f          
-#define SHADE_BAND_EDGE           0
-
-// PeakData class
-//
-// Simple data class that holds the music peaks for up to 32 bands.  When the sound analyzer finishes a pass, its
-// results are simplified down to this small class of band peaks.
-
-class PeakData
-{
-  public:
-
-  float Peaks[BAND_COUNT];
-
-  PeakData()
-  {
-    for (int i = 0; i < ARRAYSIZE(Peaks); i++)
-      Peaks[i] = 0.0f;
-  }
-};
-
-// SpectrumDisplay
-//
-// Responsible for drawing the spectrum analyzer on the RGB LED matrix given a never ending
-// series of PeakData objects coming out of the FFT thread
-
-class SpectrumDisplay
-{
-  private:
-
-    LEDMatrixGFX    * _pMatrix;
-    byte              _numberOfBands;
-
-    PeakData          _peaks;
-
-    float             _peak1Decay[BAND_COUNT] = { 0 };
-    float             _peak2Decay[BAND_COUNT] = { 0 };
-  
-    unsigned long     _lastPeak1Time[BAND_COUNT] = { 0 } ;
-
-    // SpectrumDisplay::DecayPeaks
-    //
-    // Every so many ms we decay the peaks by a given amount
-
-    void DecayPeaks()
-    {
-        static unsigned long lastDecay = 0;
-        float seconds = (millis() - lastDecay) / (float)MS_PER_SECOND;
-        lastDecay = millis();
-
-        float decayAmount1 = std::max(0.0f, seconds * gPeakDecay);
-        float decayAmount2 = seconds * PEAK2_DECAY_PER_SECOND;
-
-        for (int iBand = 0; iBand < BAND_COUNT; iBand++)
-        {
-            _peak1Decay[iBand] -= std::min(decayAmount1, _peak1Decay[iBand]);    
-            _peak2Decay[iBand] -= std::min(decayAmount2, _peak2Decay[iBand]);    
-        }
-    }
-
-    // Display::DrawBand
-    //
-    // Draws the bar graph rectangle for a bar and then the white line on top of it
-
-    void DrawBand(byte iBand, uint16_t baseColor)
-    {
-        int value  = _peak1Decay[iBand]  * (_pMatrix->height() - 1);
-        int value2 = _peak2Decay[iBand] * _pMatrix->height();
-
-        if (value > _pMatrix->height())
-            value = _pMatrix->height();
-    
-        if (value2 > _pMatrix->height())
-            value2 = _pMatrix->height();
-
-        int bandWidth = _pMatrix->width() / _numberOfBands;
-        int xOffset   = iBand * bandWidth;
-        int yOffset   = _pMatrix->height() - value;
-        int yOffset2  = _pMatrix->height() - value2;
-    
-       int iRow = 0;
-       for (int y = yOffset2; y < _pMatrix->height(); y++)
-        {
-            CRGB color = _pMatrix->from16Bit(baseColor);
-            iRow++;
-            _pMatrix->drawLine(xOffset, y, xOffset+bandWidth-1, y, _pMatrix->to16bit(color));
-        }
-    
-        #if SHADE_BAND_EDGE
-            CRGB color = _pMatrix->from16Bit(baseColor);
-            color.fadeToBlackBy(32);
-            baseColor = _pMatrix->to16bit(color);
-            _pMatrix->drawLine(xOffset+bandWidth-1, yOffset2, xOffset+bandWidth-1, _pMatrix->height(), baseColor);
-        #endif
-
-        const int PeakFadeTime_ms = 1000;
-
-        CRGB colorHighlight = CRGB(CRGB::White);
-	    unsigned long msPeakAge = millis() - _lastPeak1Time[iBand];
-	    if (msPeakAge > PeakFadeTime_ms)
-		    msPeakAge = PeakFadeTime_ms;
-	    
-        float agePercent = (float) msPeakAge / (float) MS_PER_SECOND;
-	    byte fadeAmount = std::min(255.0f, agePercent * 256);
-
-        colorHighlight = CRGB(CRGB::White).fadeToBlackBy(fadeAmount);
-
-        if (value == 0)
-		    colorHighlight = _pMatrix->from16Bit(baseColor);
-
-        // if gPeakDecay is less than zero we interpret that here to mean "don't draw it at all".  
-
-        if (gPeakDecay >= 0.0f)
-            _pMatrix->drawLine(xOffset, max(0, yOffset-1), xOffset + bandWidth - 1, max(0, yOffset-1),_pMatrix->to16bit(colorHighlight));
-    }
-
-  public:
-
-    SpectrumDisplay(LEDMatrixGFX * pgfx, byte numberOfBands)
-    {
-        _pMatrix = pgfx;
-        _numberOfBands = numberOfBands;
-    }
-
-    // Display::SetPeaks
-    //
-    // Allows the analyzer to call and set the peak data for all of the bands at once.
-
-    void SetPeaks(byte bands, PeakData peakData)
-    {
-        //Serial.print("SetPeaks: ");
-        for (int i = 0; i < bands; i++)
-        {
-            //Serial.printf("%f, ", peakData.Peaks[i]);
-
-            if (peakData.Peaks[i] > _peak1Decay[i])
-	        {
-                _peak1Decay[i] = peakData.Peaks[i];
-		        _lastPeak1Time[i] = millis();				// For the white line top peak we track when it was set so we can age it out visually
-	        }
-            if (peakData.Peaks[i] > _peak2Decay[i])
-	        {
-                _peak2Decay[i] = peakData.Peaks[i];
-	        }
-        }
-        //Serial.println("");
-    }
-
-    void Draw(int baseHue)
-    {
-        _pMatrix->fillScreen(BLACK);
-        for (int i = 0; i < _numberOfBands; i++)
-        {
-            CRGB color = ColorFromPalette(allPalettes[giColorScheme], i*16 + baseHue);           
-            DrawBand(i, _pMatrix->to16bit(color));
-        }
-        DrawVUMeter(0);
-        DecayPeaks();
-    }
-
-    // DrawVUMeter
-    // 
-    // Draws the symmetrical VU meter along with its fading peaks up at the top of the display.
-
-    void DrawVUMeter(int yVU)
-    {
-        static int iPeakVUy = 0;        // size (in LED pixels) of the VU peak
-        static unsigned long msPeakVU = 0;       // timestamp in ms when that peak happened so we know how old it is
-
-        const int MAX_FADE = 256;
-
-        _pMatrix->fillRect(0, yVU, _pMatrix->width(), 1, BLACK16);
-
-        if (iPeakVUy > 1)
-        {
-            int fade = MAX_FADE * (millis() - msPeakVU) / (float) MS_PER_SECOND;
-            DrawVUPixels(iPeakVUy,   yVU, fade);
-            DrawVUPixels(iPeakVUy-1, yVU, fade);
-        }
-
-        int xHalf = _pMatrix->width()/2-1;
-        int bars  = map(gVU, 0, MAX_VU, 1, xHalf);
-        bars = min(bars, xHalf);
-
-        if (bars > iPeakVUy)
-        {
-            msPeakVU = millis();
-            iPeakVUy = bars;
-        }
-        else if (millis() - msPeakVU > MS_PER_SECOND)
-        {
-            iPeakVUy = 0;
-        }
-
-        for (int i = 0; i < bars; i++)
-            DrawVUPixels(i, yVU);
-    }
-
-    // SpectrumDisplay::DrawVUPixels
-
-	void DrawVUPixels(int i, int yVU, int fadeBy = 0)
-	{
-		int xHalf = _pMatrix->width()/2;
-		_pMatrix->drawPixel(xHalf-i-1, yVU, ColorFromPalette(vuPalette256, i*(256/xHalf)).fadeToBlackBy(fadeBy));
-		_pMatrix->drawPixel(xHalf+i,   yVU, ColorFromPalette(vuPalette256, i*(256/xHalf)).fadeToBlackBy(fadeBy));
-	}
-};
+//+--------------------------------------------------------------------------
+//
+// SpectrumDisplayIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        SpectrumDisplay.h
+//
+// Description:
+//
+//   Spectrum analyzer display.  Draws the bands and the peak highlights
+//   and the VU meter.
+//
+// History:     Sep-12-2018         Davepl      Commented
+//
+//---------------------------------------------------------------------------
+
+#define PEAK2_DECAY_PER_SECOND  2.2f          
+#define SHADE_BAND_EDGE           0
+#define VU_ROW                    0           // The VU meter owns the top row; the bands get the rest
+#define FIRST_BAND_ROW            (VU_ROW + 1)
+
+// PeakData class
+//
+// Simple data class that holds the music peaks for each band.  When the sound analyzer finishes a pass, its
+// results are simplified down to this small class of band peaks, stamped with the time of the newest sample
+// that went into them.
+
+template <size_t BandCount>
+class PeakData
+{
+  public:
+
+  float Peaks[BandCount];
+  unsigned long Timestamp = 0;          // micros() when the newest sample in the window was taken
+
+  PeakData()
+  {
+    for (size_t i = 0; i < BandCount; i++)
+      Peaks[i] = 0.0f;
+  }
+};
+
+// SpectrumDisplay
+//
+// Responsible for drawing the spectrum analyzer on the RGB LED matrix given a never ending
+// series of PeakData objects coming out of the FFT thread
+//
+// The display owns the matrix and draws incrementally: it remembers what it last drew in each band's column and
+// only touches the pixels that need to change, so nobody should clear the matrix between frames.  If something
+// else does draw on it, call Invalidate() and the next frame is redrawn from scratch.
+//
+// SetPeaks is called from the sampler core and Draw from the matrix core.  The only thing they share is a
+// TripleBuffer of PeakData, so all the peak and decay state below belongs to the drawing side alone.
+//
+// The matrix redraws faster than the FFT delivers frames, so rather than stepping from one frame to the next the
+// display keeps the last two and slides between them, taking as long to get from one to the other as the
+// sampler did.  That runs a frame behind the newest data, FFT_HOP / SAMPLING_FREQUENCY seconds of it.  The result
+// goes through an attack/release envelope per band before it raises the bars.
+
+template <size_t BandCount>
+class SpectrumDisplay
+{
+  private:
+
+    LEDMatrixGFX    * _pMatrix;
+
+    TripleBuffer<PeakData<BandCount>> _incoming;        // Newest peaks from the sampler, not yet applied
+
+    PeakData<BandCount> _previous;                      // The two most recent frames we're sliding between
+    PeakData<BandCount> _latest;
+    unsigned long     _latestArrival = 0;               // micros() when _latest came in
+    unsigned long     _lastLevelTime = 0;               // micros() when _level was last brought up to date
+    float             _level[BandCount] = { 0 };        // Interpolated and enveloped level of each band
+    float             _attack[BandCount];               // Envelope time constants, in seconds
+    float             _release[BandCount];
+
+    static constexpr unsigned long MAX_FRAME_GAP = 100000;  // Frames further apart than this (us) aren't interpolated
+
+    float             _peak1Decay[BandCount] = { 0 };
+    float             _peak2Decay[BandCount] = { 0 };
+  
+    unsigned long     _lastPeak1Time[BandCount] = { 0 } ;
+    unsigned long     _lastDecay = 0;                   // millis() when the peaks were last decayed
+
+    int               _iPeakVUy = 0;                    // size (in LED pixels) of the VU peak
+    unsigned long     _msPeakVU = 0;                    // timestamp in ms when that peak happened so we know how old it is
+
+    bool              _valid = false;                   // Whether the _drawn state matches the matrix
+    int               _drawnTop[BandCount];             // First row of each bar, or the height if there's no bar
+    int               _drawnPeakRow[BandCount];         // Row of each peak line, or -1 if there isn't one
+    CRGB              _drawnBarColor[BandCount];
+    CRGB              _drawnPeakColor[BandCount];
+
+    // SpectrumDisplay::DecayPeaks
+    //
+    // Every so many ms we decay the peaks by a given amount
+
+    void DecayPeaks()
+    {
+        float seconds = (millis() - _lastDecay) / (float)MS_PER_SECOND;
+        _lastDecay = millis();
+
+        float decayAmount1 = std::max(0.0f, seconds * gPeakDecay);
+        float decayAmount2 = seconds * PEAK2_DECAY_PER_SECOND;
+
+        for (size_t iBand = 0; iBand < BandCount; iBand++)
+        {
+            _peak1Decay[iBand] -= std::min(decayAmount1, _peak1Decay[iBand]);    
+            _peak2Decay[iBand] -= std::min(decayAmount2, _peak2Decay[iBand]);    
+        }
+    }
+
+    // SpectrumDisplay::RowColor
+    //
+    // What a given row of a band's column should currently look like: the peak line, the bar, or nothing
+
+    CRGB RowColor(byte iBand, int y) const
+    {
+        if (y == _drawnPeakRow[iBand])
+            return _drawnPeakColor[iBand];
+        if (y >= _drawnTop[iBand])
+            return _drawnBarColor[iBand];
+        return CRGB(CRGB::Black);
+    }
+
+    // SpectrumDisplay::PaintRows
+    //
+    // Paints rows y0 up to y1 of a band's column with whatever RowColor says belongs there, as a few solid
+    // rectangles: the black above the bar, the peak line, and the bar itself
+
+    void PaintRows(byte iBand, int y0, int y1)
+    {
+        y0 = std::max(y0, FIRST_BAND_ROW);
+        y1 = std::min(y1, (int) _pMatrix->height());
+
+        int bandWidth = _pMatrix->width() / BandCount;
+        int xOffset   = iBand * bandWidth;
+        int top       = _drawnTop[iBand];
+        int peakRow   = _drawnPeakRow[iBand];
+
+        while (y0 < y1)
+        {
+            // Find where the color next changes
+
+            int yEnd = y1;
+            for (int edge : { top, peakRow, peakRow + 1 })
+                if (edge > y0 && edge < yEnd)
+                    yEnd = edge;
+
+            CRGB color = RowColor(iBand, y0);
+            _pMatrix->fillRect(xOffset, y0, bandWidth, yEnd - y0, color);
+
+            #if SHADE_BAND_EDGE
+                if (y0 >= top && y0 != peakRow)
+                    _pMatrix->drawFastVLine(xOffset + bandWidth - 1, y0, yEnd - y0, CRGB(color).fadeToBlackBy(32));
+            #endif
+
+            y0 = yEnd;
+        }
+    }
+
+    // Display::DrawBand
+    //
+    // Works out where the bar and the white line on top of it belong now, then repaints only the rows of the
+    // column that differ from what we drew last frame: the rows between the old and new tops of the bar, plus the
+    // old and new peak lines.  If the bar's color has moved on, the whole bar is repainted.
+
+    void DrawBand(byte iBand, CRGB baseColor)
+    {
+        int value  = _peak1Decay[iBand]  * (_pMatrix->height() - 1);
+        int value2 = _peak2Decay[iBand] * _pMatrix->height();
+
+        if (value > _pMatrix->height())
+            value = _pMatrix->height();
+    
+        if (value2 > _pMatrix->height())
+            value2 = _pMatrix->height();
+
+        int yOffset   = _pMatrix->height() - value;
+        int yOffset2  = _pMatrix->height() - value2;
+    
+        const int PeakFadeTime_ms = 1000;
+
+        CRGB colorHighlight = CRGB(CRGB::White);
+	    unsigned long msPeakAge = millis() - _lastPeak1Time[iBand];
+	    if (msPeakAge > PeakFadeTime_ms)
+		    msPeakAge = PeakFadeTime_ms;
+	    
+        float agePercent = (float) msPeakAge / (float) MS_PER_SECOND;
+	    byte fadeAmount = std::min(255.0f, agePercent * 256);
+
+        colorHighlight = CRGB(CRGB::White).fadeToBlackBy(fadeAmount);
+
+        if (value == 0)
+		    colorHighlight = baseColor;
+
+        // if gPeakDecay is less than zero we interpret that here to mean "don't draw it at all".  
+
+        int  newPeakRow   = (gPeakDecay >= 0.0f) ? max(0, yOffset-1) : -1;
+        CRGB newBarColor  = _pMatrix->gammaCorrect(baseColor);
+        CRGB newPeakColor = _pMatrix->gammaCorrect(colorHighlight);
+
+        int  oldTop       = _drawnTop[iBand];
+        int  oldPeakRow   = _drawnPeakRow[iBand];
+        bool peakChanged  = newPeakRow != oldPeakRow || newPeakColor != _drawnPeakColor[iBand];
+
+        int y0 = std::min(oldTop, yOffset2);
+        int y1 = (newBarColor != _drawnBarColor[iBand]) ? _pMatrix->height() : std::max(oldTop, yOffset2);
+
+        _drawnTop[iBand]       = yOffset2;
+        _drawnPeakRow[iBand]   = newPeakRow;
+        _drawnBarColor[iBand]  = newBarColor;
+        _drawnPeakColor[iBand] = newPeakColor;
+
+        PaintRows(iBand, y0, y1);
+
+        if (oldPeakRow != newPeakRow && (oldPeakRow < y0 || oldPeakRow >= y1))
+            PaintRows(iBand, oldPeakRow, oldPeakRow + 1);
+        if (peakChanged && (newPeakRow < y0 || newPeakRow >= y1))
+            PaintRows(iBand, newPeakRow, newPeakRow + 1);
+    }
+
+    // SpectrumDisplay::UpdateLevels
+    //
+    // Brings each band's level up to the given time: the spot between the last two frames we should be showing
+    // by now, smoothed by the band's envelope.  If the next frame is late we hold at the newest one rather than
+    // guess past it, since a guess would have to jump back when the real frame arrived.
+
+    void UpdateLevels(unsigned long now)
+    {
+        unsigned long gap  = _latest.Timestamp - _previous.Timestamp;
+        float fraction     = 1.0f;
+        if (gap > 0 && gap < MAX_FRAME_GAP)
+            fraction = std::min(1.0f, (now - _latestArrival) / (float) gap);
+
+        float seconds  = (now - _lastLevelTime) / 1000000.0f;
+        _lastLevelTime = now;
+
+        for (size_t i = 0; i < BandCount; i++)
+        {
+            float target = _previous.Peaks[i] + (_latest.Peaks[i] - _previous.Peaks[i]) * fraction;
+            float tau    = (target > _level[i]) ? _attack[i] : _release[i];
+            if (tau > 0.0f)
+                _level[i] += (target - _level[i]) * (1.0f - expf(-seconds / tau));
+            else
+                _level[i] = target;
+        }
+    }
+
+    // SpectrumDisplay::ApplyPeaks
+    //
+    // Raises the bars and the peak lines to the current band levels
+
+    void ApplyPeaks(const float * pLevels)
+    {
+        //Serial.print("ApplyPeaks: ");
+        for (size_t i = 0; i < BandCount; i++)
+        {
+            //Serial.printf("%f, ", pLevels[i]);
+
+            if (pLevels[i] > _peak1Decay[i])
+	        {
+                _peak1Decay[i] = pLevels[i];
+		        _lastPeak1Time[i] = millis();				// For the white line top peak we track when it was set so we can age it out visually
+	        }
+            if (pLevels[i] > _peak2Decay[i])
+	        {
+                _peak2Decay[i] = pLevels[i];
+	        }
+        }
+        //Serial.println("");
+    }
+
+  public:
+
+    SpectrumDisplay(LEDMatrixGFX * pgfx)
+    {
+        _pMatrix = pgfx;
+        for (size_t i = 0; i < BandCount; i++)
+            SetEnvelope(i, BAND_ATTACK_MS, BAND_RELEASE_MS);
+    }
+
+    // SpectrumDisplay::SetEnvelope
+    //
+    // How quickly, as time constants in ms, a band's bar rises and falls toward the spectrum; 0 is immediately
+
+    void SetEnvelope(size_t iBand, float attackMs, float releaseMs)
+    {
+        _attack[iBand]  = attackMs  / MS_PER_SECOND;
+        _release[iBand] = releaseMs / MS_PER_SECOND;
+    }
+
+    // Display::SetPeaks
+    //
+    // Allows the analyzer to call and set the peak data for all of the bands at once.  Never waits on the drawing
+    // side; if it hasn't picked up the last set yet, the two are merged so a short peak still gets drawn.
+
+    void SetPeaks(const PeakData<BandCount> & peakData)
+    {
+        TIME_STAGE(STAGE_SET_PEAKS);
+
+        _incoming.Write(peakData, [](PeakData<BandCount> & next, const PeakData<BandCount> & unread)
+        {
+            for (size_t i = 0; i < BandCount; i++)
+                next.Peaks[i] = std::max(next.Peaks[i], unread.Peaks[i]);
+        });
+    }
+
+    // SpectrumDisplay::Invalidate
+    //
+    // Forget what we drew, so the next Draw clears the matrix and starts over
+
+    void Invalidate()
+    {
+        _valid = false;
+    }
+
+    void Draw(int baseHue)
+    {
+        TIME_STAGE(STAGE_DRAW);
+
+        unsigned long now = micros();
+
+        PeakData<BandCount> peaks;
+        if (_incoming.Read(peaks))
+        {
+            _previous      = _latest;
+            _latest        = peaks;
+            _latestArrival = now;
+        }
+        UpdateLevels(now);
+        ApplyPeaks(_level);
+
+        if (!_valid)
+        {
+            _pMatrix->fillScreen(CRGB(CRGB::Black));
+            for (size_t i = 0; i < BandCount; i++)
+            {
+                _drawnTop[i]       = _pMatrix->height();
+                _drawnPeakRow[i]   = -1;
+                _drawnBarColor[i]  = CRGB(CRGB::Black);
+                _drawnPeakColor[i] = CRGB(CRGB::Black);
+            }
+            _valid = true;
+        }
+
+        for (size_t i = 0; i < BandCount; i++)
+        {
+            CRGB color = ColorFromPalette(allPalettes[giColorScheme], i*16 + baseHue);           
+            DrawBand(i, color);
+        }
+        DrawVUMeter(VU_ROW);
+        DecayPeaks();
+    }
+
+    // DrawVUMeter
+    // 
+    // Draws the symmetrical VU meter along with its fading peaks up at the top of the display.
+
+    void DrawVUMeter(int yVU)
+    {
+        const int MAX_FADE = 256;
+
+        _pMatrix->drawFastHLine(0, yVU, _pMatrix->width(), CRGB(CRGB::Black));
+
+        if (_iPeakVUy > 1)
+        {
+            int fade = MAX_FADE * (millis() - _msPeakVU) / (float) MS_PER_SECOND;
+            DrawVUPixels(_iPeakVUy,   yVU, fade);
+            DrawVUPixels(_iPeakVUy-1, yVU, fade);
+        }
+
+        int xHalf = _pMatrix->width()/2-1;
+        int bars  = map(gVU, 0, MAX_VU, 1, xHalf);
+        bars = min(bars, xHalf);
+
+        if (bars > _iPeakVUy)
+        {
+            _msPeakVU = millis();
+            _iPeakVUy = bars;
+        }
+        else if (millis() - _msPeakVU > MS_PER_SECOND)
+        {
+            _iPeakVUy = 0;
+        }
+
+        for (int i = 0; i < bars; i++)
+            DrawVUPixels(i, yVU);
+    }
+
+    // SpectrumDisplay::DrawVUPixels
+
+	void DrawVUPixels(int i, int yVU, int fadeBy = 0)
+	{
+		int xHalf = _pMatrix->width()/2;
+		_pMatrix->drawPixel(xHalf-i-1, yVU, ColorFromPalette(vuPalette256, i*(256/xHalf)).fadeToBlackBy(fadeBy));
+		_pMatrix->drawPixel(xHalf+i,   yVU, ColorFromPalette(vuPalette256, i*(256/xHalf)).fadeToBlackBy(fadeBy));
+	}
+};
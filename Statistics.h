@@ -0,0 +1,150 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Statistics.h
+//
+// Description:
+//
+//   Sample counters that are safe to read from any core.  Each block of
+//   counters has exactly one writer, the sample source (usually the timer
+//   ISR) or the sampler task,
+//   so an update is a plain local add with nothing to contend over.  The
+//   counts are 64 bits so they don't wrap in any sane uptime, and since
+//   the ESP32 can't store 64 bits at once each block is guarded by a
+//   sequence number: readers retry if they catch the writer mid-update,
+//   and so always see a set of counts that all belong together.
+//
+//   A snapshot carries the time it was taken, so two of them give rates.
+//   Each SoundAnalyzer keeps its own set.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+// CounterBlock
+//
+// Count 64 bit counters with a single writer and any number of readers.  The writer keeps its own copy of the
+// counts and publishes them as 32 bit halves between two bumps of the sequence number, which is odd while an
+// update is in progress.
+
+template <size_t Count>
+class CounterBlock
+{
+  private:
+
+	uint64_t		  _values[Count] = { 0 };			// The writer's copy
+	volatile uint32_t _sequence = 0;
+	volatile uint32_t _low[Count]  = { 0 };
+	volatile uint32_t _high[Count] = { 0 };
+
+  public:
+
+	// CounterBlock::Add
+	//
+	// Writer side only.  Adds to every counter at once and publishes them together.
+
+	inline void Add(const uint32_t (&deltas)[Count]) __attribute__((always_inline))
+	{
+		uint32_t sequence = _sequence;
+		__atomic_store_n(&_sequence, sequence + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		for (size_t i = 0; i < Count; i++)
+		{
+			_values[i] += deltas[i];
+			_low[i]  = (uint32_t) _values[i];
+			_high[i] = (uint32_t)(_values[i] >> 32);
+		}
+		__atomic_store_n(&_sequence, sequence + 2, __ATOMIC_RELEASE);
+	}
+
+	// CounterBlock::Read
+	//
+	// Any core.  Copies out all of the counters as of one moment.  Spins while an update is in progress, so it
+	// mustn't be called from anything that could preempt the writer on its own core.
+
+	void Read(uint64_t * pValues) const
+	{
+		for (;;)
+		{
+			uint32_t before = __atomic_load_n(&_sequence, __ATOMIC_ACQUIRE);
+			for (size_t i = 0; i < Count; i++)
+				pValues[i] = ((uint64_t) _high[i] << 32) | _low[i];
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+			if (!(before & 1) && __atomic_load_n(&_sequence, __ATOMIC_RELAXED) == before)
+				return;
+		}
+	}
+};
+
+// SampleStats
+//
+// What the sampler has seen, as of one moment
+
+struct SampleStats
+{
+	unsigned long Micros;									// When the snapshot was taken
+	uint64_t	  Delivered;								// Frames the source put into the ring; one per timer interrupt for the ADC
+	uint64_t	  Samples;									// Samples the sampler pulled out of the ring and used
+	uint64_t	  Misses;									// Samples overwritten in the ring before the sampler got to them
+
+	// SampleStats::PerSecond
+	//
+	// How fast a counter went up between an earlier snapshot and this one
+
+	double PerSecond(uint64_t SampleStats::* counter, const SampleStats & earlier) const
+	{
+		unsigned long elapsed = Micros - earlier.Micros;
+		return elapsed ? (this->*counter - earlier.*counter) * 1000000.0 / elapsed : 0.0;
+	}
+};
+
+// SampleStatistics
+//
+// The source's counters and the sampler task's, kept apart so that neither ever writes anything the other does
+
+class SampleStatistics
+{
+  private:
+
+	enum { SOURCE_DELIVERED, SOURCE_COUNTERS };
+	enum { SAMPLER_SAMPLES, SAMPLER_MISSES, SAMPLER_COUNTERS };
+
+	CounterBlock<SOURCE_COUNTERS>  _source;
+	CounterBlock<SAMPLER_COUNTERS> _sampler;
+
+  public:
+
+	// Sample source only, from the timer ISR or whatever task delivers its blocks
+
+	inline void CountDelivered(uint32_t frames) __attribute__((always_inline))
+	{
+		_source.Add({ frames });
+	}
+
+	// Sampler task only
+
+	void CountSamples(uint32_t used, uint32_t missed)
+	{
+		_sampler.Add({ used, missed });
+	}
+
+	// SampleStatistics::Snapshot
+	//
+	// Any core.  Each block is read as of one moment, though the two can be a sample or so apart.
+
+	SampleStats Snapshot() const
+	{
+		uint64_t source[SOURCE_COUNTERS], sampler[SAMPLER_COUNTERS];
+		_source.Read(source);
+		_sampler.Read(sampler);
+
+		SampleStats stats;
+		stats.Micros	 = micros();
+		stats.Delivered	 = source[SOURCE_DELIVERED];
+		stats.Samples	 = sampler[SAMPLER_SAMPLES];
+		stats.Misses	 = sampler[SAMPLER_MISSES];
+		return stats;
+	}
+};
@@ -0,0 +1,94 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        TripleBuffer.h
+//
+// Description:
+//
+//   Lock-free single producer / single consumer handoff of whole frames,
+//   for passing each new set of peaks from the sampler core to the matrix
+//   core.  There are three slots: the producer fills its own, the consumer
+//   reads its own, and the third sits in the middle holding the newest
+//   finished frame.  Publishing swaps the producer's slot with the middle
+//   one and reading swaps the consumer's with it, so neither side ever
+//   waits on the other and the consumer always sees a whole frame, never
+//   half of one and half of the next.
+//
+//   If the producer publishes faster than the consumer reads, frames the
+//   consumer never saw are replaced.  Write can fold the unread frame into
+//   its replacement so that whatever it carried isn't simply lost.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+template <typename T>
+class TripleBuffer
+{
+  private:
+
+	static constexpr uint8_t FRESH = 0x04;			// Set in _middle when it holds a frame the consumer hasn't read
+	static constexpr uint8_t INDEX = 0x03;
+
+	T				 _slots[3];
+	uint8_t			 _back   = 0;					// Owned by the producer
+	uint8_t			 _front  = 1;					// Owned by the consumer
+	volatile uint8_t _middle = 2;					// Shared: slot index plus the FRESH bit
+	T				 _last;							// The producer's copy of what it last published
+
+  public:
+
+	// TripleBuffer::Write
+	//
+	// Producer side.  Publishes a new frame.
+
+	void Write(const T & value)
+	{
+		_slots[_back] = value;
+		_back = __atomic_exchange_n(&_middle, (uint8_t)(_back | FRESH), __ATOMIC_ACQ_REL) & INDEX;
+	}
+
+	// TripleBuffer::Write
+	//
+	// Producer side.  Publishes a new frame, but if the consumer never got to the last one, first calls
+	// fold(value, last) to merge that one into this.  Only the producer ever sets FRESH, so if the consumer takes
+	// the last frame while we're folding, the compare fails and we publish the new frame as it was.
+
+	template <typename Fold>
+	void Write(const T & value, Fold fold)
+	{
+		uint8_t middle = __atomic_load_n(&_middle, __ATOMIC_ACQUIRE);
+
+		_slots[_back] = value;
+		if (middle & FRESH)
+		{
+			fold(_slots[_back], _last);
+			if (!__atomic_compare_exchange_n(&_middle, &middle, (uint8_t)(_back | FRESH), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			{
+				_slots[_back] = value;
+				middle = __atomic_exchange_n(&_middle, (uint8_t)(_back | FRESH), __ATOMIC_ACQ_REL);
+			}
+		}
+		else
+			middle = __atomic_exchange_n(&_middle, (uint8_t)(_back | FRESH), __ATOMIC_ACQ_REL);
+
+		_last = _slots[_back];
+		_back = middle & INDEX;
+	}
+
+	// TripleBuffer::Read
+	//
+	// Consumer side.  If a frame has been published since the last Read, copies it out and returns true;
+	// otherwise leaves value alone and returns false.
+
+	bool Read(T & value)
+	{
+		if (!(__atomic_load_n(&_middle, __ATOMIC_ACQUIRE) & FRESH))
+			return false;
+
+		_front = __atomic_exchange_n(&_middle, _front, __ATOMIC_ACQ_REL) & INDEX;
+		value = _slots[_front];
+		return true;
+	}
+};
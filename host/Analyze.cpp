@@ -0,0 +1,185 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Analyze.cpp
+//
+// Description:
+//
+//   Runs a recording through the analyzer offline, so that band layouts,
+//   EQ and gain settings can be tuned against real program material and
+//   the results compared from one build to the next.  A FileSource plays
+//   the audio into the same SoundAnalyzer the sampler task runs, one hop
+//   at a time, and every frame's band peaks are written out along with
+//   the VU (gVU) and auto gain (gScaler) as they stood after it.
+//
+//   The recording should be a 16 bit PCM WAV file.  Stereo is mixed down
+//   to mono and any other rate is resampled to the sampler's.
+//
+//   CSV output has a header row and then one row per frame:
+//
+//     Frame,Seconds,VU,Scaler,Band0,Band1,...
+//
+//   where Seconds is the time of the newest sample in the frame's window.
+//   Binary output is a header followed by one record per frame, all little
+//   endian:
+//
+//     char     Magic[4]            "SFPK"
+//     uint32_t Version             1
+//     uint32_t BandCount
+//     uint32_t SampleRate
+//     uint32_t FFTSize
+//     uint32_t HopSize
+//
+//     float    Seconds, VU, Scaler, Peaks[BandCount]
+//
+//   In throughput mode nothing is written; instead the file is analyzed
+//   the given number of times and the tool reports frames per second and
+//   seconds of audio per second of wall clock, then the stage histograms.
+//
+// Usage:
+//
+//   SoundFrameAnalyze input.wav [--csv out.csv | --binary out.bin | --throughput [passes]] [--overlap n]
+//
+//   With neither --csv nor --binary the CSV goes to stdout.
+//
+//---------------------------------------------------------------------------
+
+#include "SoundFrameHost.h"
+#include "HostSources.h"
+
+#include <chrono>
+#include <vector>
+
+enum OutputFormat { OUTPUT_CSV, OUTPUT_BINARY, OUTPUT_NONE };
+
+static void Usage()
+{
+	fprintf(stderr, "Usage: SoundFrameAnalyze input.wav [--csv out.csv | --binary out.bin | --throughput [passes]] [--overlap n]\n");
+}
+
+// Analyze
+//
+// Streams the recording through the analyzer a hop at a time, writing each frame as it comes out.  Returns the
+// number of frames.
+
+static size_t Analyze(FileSource<1> & source, size_t hopSize, OutputFormat format, FILE * pOut)
+{
+	SoundAnalyzer analyzer;
+	analyzer.SetOverlap(MAX_SAMPLES / hopSize);
+
+	size_t frames = 0;
+	analyzer.RunToEnd(source, [&](const PeakData<BAND_COUNT> (&peaks)[1])
+	{
+		float seconds = source.Position() / (float) SAMPLING_FREQUENCY;
+		if (format == OUTPUT_CSV)
+		{
+			fprintf(pOut, "%zu,%.6f,%.3f,%.6g", frames, seconds, analyzer.VU(), analyzer.Scaler());
+			for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+				fprintf(pOut, ",%.6f", peaks[0].Peaks[iBand]);
+			fputc('\n', pOut);
+		}
+		else if (format == OUTPUT_BINARY)
+		{
+			float record[3 + BAND_COUNT] = { seconds, analyzer.VU(), analyzer.Scaler() };
+			memcpy(record + 3, peaks[0].Peaks, sizeof(peaks[0].Peaks));
+			fwrite(record, sizeof(record), 1, pOut);
+		}
+		frames++;
+	});
+	return frames;
+}
+
+int main(int argc, char * argv[])
+{
+	if (argc < 2)
+	{
+		Usage();
+		return 1;
+	}
+
+	const char * pszInput  = argv[1];
+	const char * pszOutput = nullptr;
+	OutputFormat format	   = OUTPUT_CSV;
+	int			 passes	   = 1;
+	size_t		 hopSize   = FFT_HOP;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if ((!strcmp(argv[i], "--csv") || !strcmp(argv[i], "--binary")) && i + 1 < argc)
+		{
+			format	  = !strcmp(argv[i], "--csv") ? OUTPUT_CSV : OUTPUT_BINARY;
+			pszOutput = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--throughput"))
+		{
+			format = OUTPUT_NONE;
+			if (i + 1 < argc && isdigit((unsigned char) argv[i + 1][0]))
+				passes = std::max(1, atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--overlap") && i + 1 < argc)
+		{
+			int overlap = atoi(argv[++i]);
+			if (overlap < 1 || MAX_SAMPLES % overlap)
+			{
+				fprintf(stderr, "The overlap has to divide the window size (%d) evenly\n", (int) MAX_SAMPLES);
+				return 1;
+			}
+			hopSize = MAX_SAMPLES / overlap;
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	FileSource<1> source(pszInput);
+	if (!source.Load())
+		return 1;
+
+	if (format == OUTPUT_NONE)
+	{
+		Instrumentation::Reset();
+
+		size_t frames = 0;
+		auto   start  = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; pass++)
+			frames += Analyze(source, hopSize, OUTPUT_NONE, nullptr);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		double audioSeconds = passes * source.Frames() / (double) SAMPLING_FREQUENCY;
+		printf("%s: %.1f s of audio x %d, %zu frames, %d bands, hop %zu\n", pszInput, audioSeconds / passes, passes, frames, BAND_COUNT, hopSize);
+		printf("%.0f frames/sec, %.1f audio seconds per wall second\n\n", frames / elapsed, audioSeconds / elapsed);
+		fflush(stdout);
+		Instrumentation::Dump();
+		return 0;
+	}
+
+	FILE * pOut = pszOutput ? fopen(pszOutput, format == OUTPUT_BINARY ? "wb" : "w") : stdout;
+	if (!pOut)
+	{
+		fprintf(stderr, "Can't write %s\n", pszOutput);
+		return 1;
+	}
+
+	if (format == OUTPUT_CSV)
+	{
+		fprintf(pOut, "Frame,Seconds,VU,Scaler");
+		for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+			fprintf(pOut, ",Band%d", iBand);
+		fputc('\n', pOut);
+	}
+	else
+	{
+		const uint32_t header[] = { 1, BAND_COUNT, SAMPLING_FREQUENCY, MAX_SAMPLES, (uint32_t) hopSize };
+		fwrite("SFPK", 1, 4, pOut);
+		fwrite(header, sizeof(header), 1, pOut);
+	}
+
+	size_t frames = Analyze(source, hopSize, format, pOut);
+	if (pOut != stdout)
+		fclose(pOut);
+	fprintf(stderr, "%zu frames\n", frames);
+	return 0;
+}
@@ -0,0 +1,231 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Benchmark.cpp
+//
+// Description:
+//
+//   Host benchmark for the analyzer and display pipeline.  Feeds a fixed
+//   multi-tone signal through the sample ring, FFT and ProcessPeaks, then
+//   hands the peaks to SetPeaks/Draw/ShowMatrix, and reports how long each
+//   stage takes per frame at every band count and FFT size, on average and,
+//   from the stage histograms, at the median, the 99th percentile and worst.
+//
+//   Then it runs the matrix loop against a simulated WS2812B wire, once
+//   showing each frame in line and once with the show task, and reports
+//   the frame pacing of each.
+//
+// Usage:
+//
+//   SoundFrameBench [ms-per-case]
+//
+//---------------------------------------------------------------------------
+
+#include "SoundFrameHost.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+static const size_t  BenchFFTSizes[]   = { 256, 512, 1024, 2048 };
+
+// BenchSignal
+//
+// A few tones at different levels riding on the ADC midpoint, so every band sees some energy and the FFT
+// isn't working on trivially zero data.  Precomputed so that the ISR path is timed, not sin().
+
+static const size_t BENCH_SIGNAL_LENGTH = 8192;
+static uint16_t		g_BenchSignal[BENCH_SIGNAL_LENGTH];
+static uint32_t		g_iBenchSample = 0;
+
+static void FillBenchSignal()
+{
+	for (size_t i = 0; i < BENCH_SIGNAL_LENGTH; i++)
+	{
+		const double t = i / (double) SAMPLING_FREQUENCY;
+		double v = 0.40 * sin(2 * M_PI * 110.0  * t)
+				 + 0.25 * sin(2 * M_PI * 1000.0 * t)
+				 + 0.15 * sin(2 * M_PI * 4800.0 * t);
+		g_BenchSignal[i] = (uint16_t)(MAX_ANALOG_IN / 2 + v * (MAX_ANALOG_IN / 2 - 1));
+	}
+}
+
+static uint16_t BenchSignal(uint8_t pin)
+{
+	if (pin != INPUT_PIN)
+		return 0;
+	return g_BenchSignal[g_iBenchSample++ % BENCH_SIGNAL_LENGTH];
+}
+
+// StageTimer
+//
+// Accumulates wall time for one pipeline stage across many frames
+
+struct StageTimer
+{
+	const char		* pszName;
+	int				  iStage;									// Histogram for this stage, or -1 if it has none
+	BenchClock::duration total = BenchClock::duration::zero();
+	uint64_t		  frames   = 0;
+
+	StageTimer(const char * name, int stage)
+		: pszName(name),
+		  iStage(stage)
+	{
+	}
+
+	double NanosPerFrame() const
+	{
+		return frames ? std::chrono::duration<double, std::nano>(total).count() / frames : 0.0;
+	}
+};
+
+static void PrintStage(size_t fftSize, size_t bandCount, const StageTimer & stage)
+{
+	double ns = stage.NanosPerFrame();
+	printf("%6zu %6zu  %-14s %14.0f %14.1f", fftSize, bandCount, stage.pszName, ns, ns > 0 ? 1e9 / ns : 0.0);
+
+	if (stage.iStage >= 0)
+	{
+		const StageHistogram & histogram = Instrumentation::Stage((PipelineStage) stage.iStage);
+		printf(" %10.0f %10.0f %10.0f", Instrumentation::CyclesToMicros(histogram.Percentile(0.50f)) * 1000,
+			   Instrumentation::CyclesToMicros(histogram.Percentile(0.99f)) * 1000, Instrumentation::CyclesToMicros(histogram.Max()) * 1000);
+	}
+	printf("\n");
+}
+
+// BenchCase
+//
+// Runs one FFT size and band count for msPerCase and prints the per-frame cost of each stage.  The band count is
+// a template parameter, just as it is for the sketch.
+
+template <size_t BandCount>
+static void BenchCase(size_t fftSize, LEDMatrixGFX & matrix, long msPerCase)
+{
+	SampleRing					ring(fftSize * 4);
+	SampleBuffer<BandCount>		buffer(fftSize, SAMPLING_FREQUENCY);
+	SpectrumDisplay<BandCount>	display(&matrix);
+
+	StageTimer acquire  { "ISR",          -1 };						// Pushed straight into the ring, not through the ISR
+	StageTimer load     { "LoadSamples",  STAGE_LOAD_SAMPLES };
+	StageTimer fft      { "FFT",          STAGE_FFT };
+	StageTimer peaks    { "ProcessPeaks", STAGE_PROCESS_PEAKS };
+	StageTimer setPeaks { "SetPeaks",     STAGE_SET_PEAKS };
+	StageTimer draw     { "Draw",         STAGE_DRAW };
+	StageTimer show     { "ShowMatrix",   STAGE_SHOW_MATRIX };
+
+	Instrumentation::Reset();
+
+	const BenchClock::time_point end = BenchClock::now() + std::chrono::milliseconds(msPerCase);
+	for (int iFrame = 0; BenchClock::now() < end; iFrame++)
+	{
+		BenchClock::time_point t0 = BenchClock::now();
+		for (size_t i = 0; i < fftSize; i++)
+			ring.Push(analogRead(INPUT_PIN));
+		BenchClock::time_point t1 = BenchClock::now();
+		buffer.LoadSamples(ring);
+		BenchClock::time_point t1a = BenchClock::now();
+		buffer.FFT();
+		BenchClock::time_point t2 = BenchClock::now();
+		buffer.ProcessPeaks();
+		PeakData<BandCount> data = buffer.GetBandPeaks();
+		buffer.Reset();
+		BenchClock::time_point t3 = BenchClock::now();
+		display.SetPeaks(data);
+		BenchClock::time_point t4 = BenchClock::now();
+		display.Draw(iFrame & 0xFF);
+		BenchClock::time_point t5 = BenchClock::now();
+		matrix.ShowMatrix();
+		BenchClock::time_point t6 = BenchClock::now();
+
+		acquire.total  += t1 - t0;
+		load.total     += t1a - t1;
+		fft.total      += t2 - t1a;
+		peaks.total    += t3 - t2;
+		setPeaks.total += t4 - t3;
+		draw.total     += t5 - t4;
+		show.total     += t6 - t5;
+		acquire.frames = load.frames = fft.frames = peaks.frames = setPeaks.frames = draw.frames = show.frames = iFrame + 1;
+	}
+
+	for (const StageTimer * pStage : { &acquire, &load, &fft, &peaks, &setPeaks, &draw, &show })
+		PrintStage(fftSize, BandCount, *pStage);
+}
+
+// BenchFramePacing
+//
+// Draws and shows frames for msPerCase with FastLED taking as long as the real wire would, and prints the
+// average render, wait and show times along with the frame rate that came out of it
+
+static void BenchFramePacing(bool showTask, long msPerCase)
+{
+	LEDMatrixGFX				matrix(MATRIX_WIDTH, MATRIX_HEIGHT, 255);
+	SpectrumDisplay<BAND_COUNT>	display(&matrix);
+	PeakData<BAND_COUNT>		data;
+
+	if (showTask)
+		matrix.StartShowTask(1, 2, STACK_SIZE);
+
+	uint64_t render = 0, wait = 0, show = 0;
+	int		 frames = 0;
+
+	const BenchClock::time_point start = BenchClock::now();
+	const BenchClock::time_point end   = start + std::chrono::milliseconds(msPerCase);
+	for (; BenchClock::now() < end; frames++)
+	{
+		for (int i = 0; i < BAND_COUNT; i++)
+			data.Peaks[i] = (float)((frames + i * 7) % 16) / 16.0f;
+		display.SetPeaks(data);
+		display.Draw(frames & 0xFF);
+		matrix.ShowMatrix();
+
+		FramePacing pacing = matrix.GetFramePacing();
+		if (frames > 0)										// The first frame's render time runs from startup
+		{
+			render += pacing.renderMicros;
+			wait   += pacing.waitMicros;
+			show   += pacing.showMicros;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(BenchClock::now() - start).count();
+	int	   counted = std::max(1, frames - 1);
+	printf("%-12s %10.0f %10.0f %10.0f %10.1f\n", showTask ? "Show task" : "In line",
+		   render / (double) counted, wait / (double) counted, show / (double) counted, frames / seconds);
+}
+
+int main(int argc, char * argv[])
+{
+	const long msPerCase = (argc > 1) ? atol(argv[1]) : 250;
+
+	FillBenchSignal();
+	HostSetAnalogReader(BenchSignal);
+
+	LEDMatrixGFX matrix(MATRIX_WIDTH, MATRIX_HEIGHT, 255);
+
+	printf("SoundFrame host benchmark: %d Hz sample rate, %s FFT, %dx%d matrix, %ld ms per case\n\n",
+		   (int) SAMPLING_FREQUENCY, FFTEngine::Name(), MATRIX_WIDTH, MATRIX_HEIGHT, msPerCase);
+	fflush(stdout);
+	SoundAnalyzer analyzer;
+	analyzer.MemoryReport();
+	printf("\n");
+
+	printf("%6s %6s  %-14s %14s %14s %10s %10s %10s\n", "FFT", "Bands", "Stage", "ns/frame", "frames/sec", "p50 ns", "p99 ns", "max ns");
+
+	for (size_t fftSize : BenchFFTSizes)
+	{
+		BenchCase<8> (fftSize, matrix, msPerCase);
+		BenchCase<16>(fftSize, matrix, msPerCase);
+		BenchCase<24>(fftSize, matrix, msPerCase);
+		BenchCase<32>(fftSize, matrix, msPerCase);
+		BenchCase<48>(fftSize, matrix, msPerCase);
+	}
+
+	printf("\nFrame pacing, %d LEDs at %d us each on the wire\n\n", MATRIX_WIDTH * MATRIX_HEIGHT, CFastLED::WIRE_MICROS_PER_LED);
+	printf("%-12s %10s %10s %10s %10s\n", "ShowMatrix", "Render us", "Wait us", "Show us", "Frames/sec");
+
+	FastLED.SimulateWireTime(true);
+	BenchFramePacing(false, msPerCase * 4);
+	BenchFramePacing(true,  msPerCase * 4);
+	FastLED.SimulateWireTime(false);
+	return 0;
+}
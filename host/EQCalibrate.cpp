@@ -0,0 +1,151 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        EQCalibrate.cpp
+//
+// Description:
+//
+//   Calibrates the band equalizer against pink noise.  Runs a recording
+//   of pink noise through the real sampler chain (ring, FFTs, band map and
+//   the EQ as built) and averages each band's equalized peak.  Whatever
+//   unevenness is left is folded into the current gains, and the result
+//   is printed as a BAND_EQ_GAINS line to drop into Globals.h or onto the
+//   compiler command line.  Run it again with those gains built in to
+//   refine them further.
+//
+//   The capture should be a PCM WAV file, 16 bit; stereo is mixed down
+//   and any other rate is resampled to the sampler's.  With no file the
+//   tool synthesizes its own pink noise, which is a check of the
+//   model-derived gains more than a calibration.
+//
+// Usage:
+//
+//   SoundFrameEQCalibrate [capture.wav] [seconds]
+//
+//---------------------------------------------------------------------------
+
+#include "SoundFrameHost.h"
+#include "HostAudio.h"
+
+#include <random>
+#include <vector>
+
+// MakePinkNoise
+//
+// White noise through Paul Kellet's pink filter, which is within half a dB of 1/f over the audio band
+
+static std::vector<int16_t> MakePinkNoise(size_t count)
+{
+	std::mt19937 rng(4321);
+	std::normal_distribution<float> white(0.0f, 1.0f);
+
+	std::vector<int16_t> samples(count);
+	float b0 = 0, b1 = 0, b2 = 0, b3 = 0, b4 = 0, b5 = 0, b6 = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		float w = white(rng);
+		b0 = 0.99886f * b0 + w * 0.0555179f;
+		b1 = 0.99332f * b1 + w * 0.0750759f;
+		b2 = 0.96900f * b2 + w * 0.1538520f;
+		b3 = 0.86650f * b3 + w * 0.3104856f;
+		b4 = 0.55000f * b4 + w * 0.5329522f;
+		b5 = -0.7616f * b5 - w * 0.0168980f;
+		float pink = b0 + b1 + b2 + b3 + b4 + b5 + b6 + w * 0.5362f;
+		b6 = w * 0.115926f;
+
+		samples[i] = (int16_t) std::max(-32767.0f, std::min(32767.0f, pink * 1500.0f));
+	}
+	return samples;
+}
+
+int main(int argc, char * argv[])
+{
+	const char * pszCapture = (argc > 1) ? argv[1] : nullptr;
+	const double seconds	= (argc > 2) ? atof(argv[2]) : 30.0;
+
+	std::vector<int16_t> capture;
+	if (pszCapture)
+	{
+		uint32_t sampleRate = 0;
+		if (!ReadWav(pszCapture, capture, sampleRate))
+		{
+			fprintf(stderr, "%s isn't a 16 bit PCM WAV file\n", pszCapture);
+			return 1;
+		}
+		if (sampleRate != SAMPLING_FREQUENCY)
+			capture = Resample(capture, sampleRate, SAMPLING_FREQUENCY);
+	}
+	else
+		capture = MakePinkNoise((size_t)(seconds * SAMPLING_FREQUENCY));
+
+	// Run it through the sampler chain exactly as the sampler task would, but stop short of the display scaling
+
+	SampleRing				 ring(SAMPLE_RING_SIZE);
+	SampleBuffer<BAND_COUNT> buffer(MAX_SAMPLES, SAMPLING_FREQUENCY);
+	buffer.SetHopSize(FFT_HOP);
+
+	const size_t warmup = MAX_SAMPLES * BASS_DECIMATION;					// Until the bass FFT's window is full
+	double		 sums[BAND_COUNT] = { 0 };
+	size_t		 frames = 0;
+
+	for (size_t i = 0; i < capture.size(); i++)
+	{
+		ring.Push(ToAdcSample(capture[i]));
+		if (ring.Available() < MAX_SAMPLES)
+			continue;
+
+		buffer.LoadSamples(ring);
+		buffer.FFT();
+		buffer.MeasureBands();
+		PeakData<BAND_COUNT> peaks = buffer.GetBandPeaks();
+		buffer.Reset();
+
+		if (i < warmup)
+			continue;
+		for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+			sums[iBand] += peaks.Peaks[iBand];
+		frames++;
+	}
+
+	if (frames == 0)
+	{
+		fprintf(stderr, "Not enough audio to calibrate with\n");
+		return 1;
+	}
+
+	// Each band's new gain scales its average to the geometric mean of all of them
+
+	double logSum = 0.0;
+	int	   used	  = 0;
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		if (sums[iBand] > 0)
+		{
+			logSum += log(sums[iBand] / frames);
+			used++;
+		}
+	}
+	const double target = used ? exp(logSum / used) : 1.0;
+
+	printf("%s: %zu frames, %d bands, %s spacing\n\n", pszCapture ? pszCapture : "synthesized pink noise", frames, BAND_COUNT,
+		   BAND_SPACING == BAND_SPACING_CLASSIC ? "classic" : BAND_SPACING == BAND_SPACING_LOG ? "log" :
+		   BAND_SPACING == BAND_SPACING_MEL ? "mel" : "octave");
+	printf("%5s %8s %12s %10s %10s %10s\n", "Band", "Cutoff", "Level", "Error dB", "Gain", "New gain");
+
+	float newGains[BAND_COUNT];
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		double level = sums[iBand] / frames;
+		double error = level > 0 ? 20 * log10(level / target) : 0.0;
+		newGains[iBand] = level > 0 ? (float)(buffer.BandGain(iBand) * target / level) : buffer.BandGain(iBand);
+		printf("%5d %8d %12.1f %10.2f %10.4f %10.4f\n", iBand, BandLayout<BAND_COUNT>::Cutoffs[iBand], level, error,
+			   buffer.BandGain(iBand), newGains[iBand]);
+	}
+
+	printf("\n#define BAND_EQ_GAINS ");
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+		printf("%s%.4ff", iBand ? ", " : "", newGains[iBand]);
+	printf("\n");
+	return 0;
+}
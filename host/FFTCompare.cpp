@@ -0,0 +1,248 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        FFTCompare.cpp
+//
+// Description:
+//
+//   Accuracy versus speed comparison of the FFT engines in FFTEngine.h.
+//   Every engine gets the same ADC-like input (DC offset, a few tones
+//   and a little noise, quantized to the ADC's range) and its magnitudes
+//   for bins 2..N/2 are compared against the double precision arduinoFFT
+//   path, which is what the analyzer was tuned with.  Like the sampler,
+//   it takes the block's mean out before any engine sees it, or the DC
+//   would set the fixed point engines' block scale.
+//
+//   SNR is the power of the reference spectrum over the power of the
+//   difference; "worst" is the largest single bin error relative to the
+//   spectrum's peak.  Both are in dB, and more negative "worst" is better.
+//
+//   It also times the old per-frame window calculation against the
+//   precomputed tables, and checks that the level corrected windows all
+//   report a bin centered tone at the same level.
+//
+// Usage:
+//
+//   SoundFrameFFTCompare [ms-per-case]
+//
+//---------------------------------------------------------------------------
+
+#include "SoundFrameHost.h"
+
+#include <random>
+#include <vector>
+
+using BenchClock = std::chrono::steady_clock;
+
+static const size_t CompareFFTSizes[] = { 256, 512, 1024, 2048 };
+
+// MakeSignal
+//
+// A frame of what the ADC hands the sampler: midpoint offset, three tones of falling level, and some noise
+
+static std::vector<double> MakeSignal(size_t samples)
+{
+	std::mt19937 rng(1234);
+	std::normal_distribution<double> noise(0.0, 8.0);
+
+	std::vector<double> signal(samples);
+	for (size_t i = 0; i < samples; i++)
+	{
+		const double t = i / (double) SAMPLING_FREQUENCY;
+		double v = MAX_ANALOG_IN / 2
+				 + 1800.0 * sin(2 * M_PI * 130.0  * t)
+				 +  600.0 * sin(2 * M_PI * 1200.0 * t)
+				 +   40.0 * sin(2 * M_PI * 6100.0 * t)
+				 + noise(rng);
+		signal[i] = std::max(0.0, std::min((double)(MAX_ANALOG_IN - 1), round(v)));
+	}
+	return signal;
+}
+
+struct CompareResult
+{
+	double	nsPerFrame;
+	double	snr;
+	double	worst;
+};
+
+// RunEngine
+//
+// MakeReference
+//
+// The double precision arduinoFFT magnitudes of a signal
+
+static std::vector<double> MakeReference(const std::vector<double> & signal)
+{
+	std::vector<double> reference = signal;
+	std::vector<double> imaginary(signal.size(), 0.0);
+	const size_t		samples = signal.size();
+
+	arduinoFFT referenceFFT;
+	referenceFFT.Windowing(reference.data(), samples, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
+	referenceFFT.Compute(reference.data(), imaginary.data(), samples, FFT_FORWARD);
+	referenceFFT.ComplexToMagnitude(reference.data(), imaginary.data(), samples);
+	return reference;
+}
+
+// Times Windowing + Compute + ComplexToMagnitude for an engine and compares its spectrum with the reference
+
+template <typename Engine>
+static CompareResult RunEngine(const std::vector<double> & signal, const std::vector<double> & reference, long msPerCase)
+{
+	typedef typename Engine::Sample Sample;
+
+	const size_t		samples = signal.size();
+	Engine				engine(samples);
+	std::vector<Sample> vReal(samples);
+
+	uint64_t frames = 0;
+	BenchClock::duration total = BenchClock::duration::zero();
+	const BenchClock::time_point end = BenchClock::now() + std::chrono::milliseconds(msPerCase);
+	do
+	{
+		for (size_t i = 0; i < samples; i++)
+			vReal[i] = (Sample) signal[i];
+		BenchClock::time_point start = BenchClock::now();
+		engine.Windowing(vReal.data());
+		engine.Compute(vReal.data());
+		engine.ComplexToMagnitude(vReal.data());
+		total += BenchClock::now() - start;
+		frames++;
+	} while (BenchClock::now() < end);
+
+	double signalPower = 0.0;
+	double errorPower  = 0.0;
+	double peak        = 0.0;
+	double worst       = 0.0;
+	for (size_t i = 2; i < samples / 2; i++)
+	{
+		double error = vReal[i] - reference[i];
+		signalPower += reference[i] * reference[i];
+		errorPower  += error * error;
+		peak  = std::max(peak, reference[i]);
+		worst = std::max(worst, fabs(error));
+	}
+
+	CompareResult result;
+	result.nsPerFrame = std::chrono::duration<double, std::nano>(total).count() / frames;
+	result.snr        = errorPower > 0 ? 10 * log10(signalPower / errorPower) : INFINITY;
+	result.worst      = worst > 0 ? 20 * log10(worst / peak) : -INFINITY;
+	return result;
+}
+
+template <typename Engine>
+static void Report(const std::vector<double> & signal, const std::vector<double> & reference, long msPerCase, double nsBaseline)
+{
+	CompareResult result = RunEngine<Engine>(signal, reference, msPerCase);
+	printf("%6zu  %-8s %12.0f %12.1f %8.2fx %9.1f %9.1f\n",
+		   signal.size(), Engine::Name(), result.nsPerFrame, 1e9 / result.nsPerFrame,
+		   nsBaseline / result.nsPerFrame, result.snr, result.worst);
+}
+
+// CompareWindowing
+//
+// Per frame cost of arduinoFFT's Windowing, which evaluates the window on every call, against multiplying in
+// one of the precomputed tables
+
+static void CompareWindowing(size_t samples, long msPerCase)
+{
+	// Refilled every pass, or repeated windowing would drive the data down into denormals
+
+	std::vector<double> vDouble(samples);
+	std::vector<float>  vFloat(samples);
+	arduinoFFT			fft;
+	const float		  * pWindow = FFTWindow<float>::Get(FFT_WINDOW_HAMMING, samples);
+
+	uint64_t framesCalc = 0, framesTable = 0;
+	BenchClock::time_point start = BenchClock::now();
+	BenchClock::time_point end   = start + std::chrono::milliseconds(msPerCase);
+	do
+	{
+		std::fill(vDouble.begin(), vDouble.end(), 1.0);
+		fft.Windowing(vDouble.data(), samples, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
+		framesCalc++;
+	} while (BenchClock::now() < end);
+	double nsCalc = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / framesCalc;
+
+	start = BenchClock::now();
+	end   = start + std::chrono::milliseconds(msPerCase);
+	do
+	{
+		std::fill(vFloat.begin(), vFloat.end(), 1.0f);
+		FFTWindow<float>::Apply(vFloat.data(), pWindow, samples);
+		framesTable++;
+	} while (BenchClock::now() < end);
+	double nsTable = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / framesTable;
+
+	printf("%6zu  %22.0f %22.0f %8.1fx\n", samples, nsCalc, nsTable, nsCalc / nsTable);
+}
+
+// CompareWindowLevels
+//
+// A tone right on a bin center should come out at the same level whichever window is used, since the tables
+// are corrected to the Hamming window's coherent gain
+
+static void CompareWindowLevels(size_t samples)
+{
+	const size_t bin = samples / 8;
+
+	std::vector<float> tone(samples);
+	for (size_t i = 0; i < samples; i++)
+		tone[i] = 1000.0f * sinf(2 * M_PI * bin * i / samples);
+
+	float hammingLevel = 0.0f;
+	for (int type = FFT_WINDOW_HAMMING; type < FFT_WINDOW_COUNT + FFT_WINDOW_HAMMING; type++)
+	{
+		FFTWindowType	   window = (FFTWindowType)(type % FFT_WINDOW_COUNT);
+		FloatFFT		   fft(samples, window);
+		std::vector<float> vData = tone;
+		fft.Windowing(vData.data());
+		fft.Compute(vData.data());
+		fft.ComplexToMagnitude(vData.data());
+		if (window == FFT_WINDOW_HAMMING)
+			hammingLevel = vData[bin];
+
+		printf("%-16s %14.4f %14.4f %14.4f\n", FFTWindowName(window), FFTWindowCoherentGain(window, samples),
+			   FFTWindowLevelCorrection(window, samples), vData[bin] / hammingLevel);
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	const long msPerCase = (argc > 1) ? atol(argv[1]) : 250;
+
+	printf("FFT engine comparison against the double precision arduinoFFT path, %ld ms per case\n\n", msPerCase);
+	printf("%6s  %-8s %12s %12s %9s %9s %9s\n", "FFT", "Engine", "ns/frame", "frames/sec", "speedup", "SNR dB", "worst dB");
+
+	for (size_t samples : CompareFFTSizes)
+	{
+		std::vector<double> signal = MakeSignal(samples);
+
+		// Every engine, and the reference, gets the block less its mean, as SampleBuffer::FFT hands it over
+
+		double mean = 0.0;
+		for (double sample : signal)
+			mean += sample / samples;
+		for (double & sample : signal)
+			sample -= mean;
+
+		std::vector<double> reference = MakeReference(signal);
+
+		double nsBaseline = RunEngine<DoubleFFT>(signal, reference, msPerCase).nsPerFrame;
+
+		Report<DoubleFFT>(signal, reference, msPerCase, nsBaseline);
+		Report<FloatFFT> (signal, reference, msPerCase, nsBaseline);
+		Report<Q31FFT>   (signal, reference, msPerCase, nsBaseline);
+		Report<Q15FFT>   (signal, reference, msPerCase, nsBaseline);
+	}
+
+	printf("\n%6s  %22s %22s %9s\n", "FFT", "Windowing ns (calc)", "Windowing ns (table)", "speedup");
+	for (size_t samples : CompareFFTSizes)
+		CompareWindowing(samples, msPerCase);
+
+	printf("\n%-16s %14s %14s %14s\n", "Window", "coherent gain", "correction", "tone vs Ham");
+	CompareWindowLevels(512);
+	return 0;
+}
@@ -0,0 +1,916 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        GoldenTests.cpp
+//
+// Description:
+//
+//   Regression tests for the analysis chain.  Each test feeds a signal we
+//   know the answer for (tones, sweeps, noise, silence, clipping and DC)
+//   through the real ring, SampleBuffer and ProcessPeaks, then checks that
+//   it came out where it should: tones in their own band and not much in
+//   any other, noise everywhere, silence nowhere, and the auto gain taking
+//   as long to settle as GAIN_DAMPEN says it should, whatever the overlap.
+//   A stereo pair checks that channels stay apart and that mid and side
+//   come out of them as they should, and the sample sources are checked
+//   for delivering what they should into the analyzer.
+//
+//   The performance test times each stage of the chain with the stage
+//   histograms, prints them, and fails if any stage blows its budget.  The
+//   budgets are generous, around ten times what a desktop takes, so they
+//   catch a stage getting a great deal slower rather than the odd noisy
+//   run.
+//
+//   CMake registers each test with ctest separately, so every test runs in
+//   its own process and starts from a fresh analyzer.
+//
+// Usage:
+//
+//   SoundFrameTests [test ...]
+//
+//   With no names it runs them all.
+//
+//---------------------------------------------------------------------------
+
+#include "SoundFrameHost.h"
+#include "HostSources.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Per frame budgets for the performance test, in microseconds at the median
+
+static const float LOAD_SAMPLES_BUDGET_US  = 20.0f;
+static const float FFT_BUDGET_US		   = 80.0f;
+static const float PROCESS_PEAKS_BUDGET_US = 20.0f;
+static const float MIN_REALTIME_FACTOR	   = 50.0f;		// Seconds of audio analyzed per second of wall clock
+
+// How far below the loudest band the engine's own rounding noise sits.  Q15 gives up a bit per stage to its block
+// scaling, so its floor is far higher than the others'.
+
+static const float ENGINE_FLOOR = FFT_ENGINE == FFT_ENGINE_Q15 ? 1.0f / 100 : 1.0f / 1000;
+
+static int g_failures = 0;
+
+#define CHECK(condition, ...)											\
+	do																	\
+	{																	\
+		if (!(condition))												\
+		{																\
+			fprintf(stderr, "  FAILED %s:%d: %s: ", __FILE__, __LINE__, #condition);	\
+			fprintf(stderr, __VA_ARGS__);								\
+			fputc('\n', stderr);										\
+			g_failures++;												\
+		}																\
+	} while (0)
+
+// Signal
+//
+// Samples as a fraction of full scale, -1 to 1 around the ADC's midpoint; anything past that clips at the rails
+
+typedef std::vector<float> Signal;
+
+static Signal Tone(float hz, float amplitude, float seconds)
+{
+	Signal signal((size_t)(seconds * SAMPLING_FREQUENCY));
+	for (size_t i = 0; i < signal.size(); i++)
+		signal[i] = amplitude * (float) sin(2 * M_PI * hz * i / SAMPLING_FREQUENCY);
+	return signal;
+}
+
+static Signal Noise(float seconds, float amplitude, bool pink)
+{
+	std::mt19937 rng(1234);
+	std::normal_distribution<float> white(0.0f, 1.0f);
+
+	Signal signal((size_t)(seconds * SAMPLING_FREQUENCY));
+	float b0 = 0, b1 = 0, b2 = 0, b3 = 0, b4 = 0, b5 = 0, b6 = 0;
+	for (size_t i = 0; i < signal.size(); i++)
+	{
+		float w = white(rng);
+		if (!pink)
+		{
+			signal[i] = amplitude * w;
+			continue;
+		}
+
+		b0 = 0.99886f * b0 + w * 0.0555179f;							// Paul Kellet's pink filter, as in EQCalibrate
+		b1 = 0.99332f * b1 + w * 0.0750759f;
+		b2 = 0.96900f * b2 + w * 0.1538520f;
+		b3 = 0.86650f * b3 + w * 0.3104856f;
+		b4 = 0.55000f * b4 + w * 0.5329522f;
+		b5 = -0.7616f * b5 - w * 0.0168980f;
+		signal[i] = amplitude * 0.2f * (b0 + b1 + b2 + b3 + b4 + b5 + b6 + w * 0.5362f);
+		b6 = w * 0.115926f;
+	}
+	return signal;
+}
+
+static Signal operator+(Signal a, const Signal & b)
+{
+	for (size_t i = 0; i < a.size() && i < b.size(); i++)
+		a[i] += b[i];
+	return a;
+}
+
+// AdcSample
+//
+// What the ADC reads for a sample of a Signal
+
+static uint16_t AdcSample(float sample)
+{
+	float adc = MAX_ANALOG_IN / 2 * (1.0f + sample);
+	return (uint16_t) std::max(0.0f, std::min((float)(MAX_ANALOG_IN - 1), roundf(adc)));
+}
+
+// Chain
+//
+// The sampler task's half of the pipeline, run on a signal instead of the ADC.  Each frame records the band peaks
+// and the VU and auto gain after it, either as ProcessPeaks leaves them or, measuring raw, as MeasureBands does
+// with the EQ taken back out.
+
+struct Frame
+{
+	float Seconds;
+	float Peaks[BAND_COUNT];
+	float VU;
+	float Scaler;
+};
+
+class Chain
+{
+  private:
+
+	SampleRing				 _ring;
+	SampleBuffer<BAND_COUNT> _buffer;
+	size_t					 _pushed = 0;
+
+  public:
+
+	Chain(int overlap = MAX_SAMPLES / FFT_HOP)
+		: _ring(SAMPLE_RING_SIZE),
+		  _buffer(MAX_SAMPLES, SAMPLING_FREQUENCY)
+	{
+		_buffer.SetHopSize(MAX_SAMPLES / overlap);
+	}
+
+	SampleBuffer<BAND_COUNT> & Buffer()
+	{
+		return _buffer;
+	}
+
+	float Seconds() const
+	{
+		return _pushed / (float) SAMPLING_FREQUENCY;
+	}
+
+	std::vector<Frame> Run(const Signal & signal, bool raw = false)
+	{
+		std::vector<Frame> frames;
+		for (float sample : signal)
+		{
+			_ring.Push(AdcSample(sample));
+			_pushed++;
+			if (_ring.Available() < MAX_SAMPLES)
+				continue;
+
+			_buffer.LoadSamples(_ring);
+			_buffer.FFT();
+			if (raw)
+				_buffer.MeasureBands();
+			else
+				_buffer.ProcessPeaks();
+			PeakData<BAND_COUNT> peaks = _buffer.GetBandPeaks();
+			_buffer.Reset();
+
+			Frame frame;
+			frame.Seconds = Seconds();
+			for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+				frame.Peaks[iBand] = raw ? peaks.Peaks[iBand] / _buffer.BandGain(iBand) : peaks.Peaks[iBand];
+			frame.VU	 = _buffer.VU();
+			frame.Scaler = _buffer.Scaler();
+			frames.push_back(frame);
+		}
+		return frames;
+	}
+};
+
+// Helpers
+
+static int LoudestBand(const Frame & frame)
+{
+	int loudest = 0;
+	for (int iBand = 1; iBand < BAND_COUNT; iBand++)
+		if (frame.Peaks[iBand] > frame.Peaks[loudest])
+			loudest = iBand;
+	return loudest;
+}
+
+static bool BandCenter(int iBand, float & hz)
+{
+	SampleBuffer<BAND_COUNT> buffer(MAX_SAMPLES, SAMPLING_FREQUENCY);
+	float low, high;
+	buffer.BandRange(iBand, low, high);
+	hz = sqrtf(std::max(low, 1.0f) * high);
+	return high > low && low > 0;
+}
+
+// A band with no bins at all can never light.  Cutoffs at or past Nyquist leave the bands above it empty, as the
+// classic 32 band table's 16.5 and 20 kHz bands are at our 25 kHz sampling rate.
+
+static bool BandIsEmpty(int iBand)
+{
+	SampleBuffer<BAND_COUNT> buffer(MAX_SAMPLES, SAMPLING_FREQUENCY);
+	float low, high;
+	buffer.BandRange(iBand, low, high);
+	return high <= low;
+}
+
+static float Decibels(float ratio)
+{
+	return ratio > 0 ? 20 * log10f(ratio) : -999.0f;
+}
+
+static bool Finite(const Frame & frame)
+{
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+		if (!std::isfinite(frame.Peaks[iBand]) || frame.Peaks[iBand] < 0)
+			return false;
+	return std::isfinite(frame.VU) && std::isfinite(frame.Scaler);
+}
+
+// The display scaling puts the loudest band at this
+
+static const float FULL_SCALE_PEAK = 1.0f / 1.1f;
+
+// How long after a signal starts to wait before measuring it.  The bass FFT's window is BASS_DECIMATION times as
+// long as the main one, and the decimator's DC blocker takes a couple more of them to forget the signal's onset.
+
+static const float BASS_WINDOW_SECONDS = (float) MAX_SAMPLES * BASS_DECIMATION / SAMPLING_FREQUENCY;
+static const float SETTLE_SECONDS	   = 4.0f * BASS_WINDOW_SECONDS;
+
+// The lowest band the main FFT measures; everything under it comes from the bass FFT's longer window
+
+static const int FIRST_MAIN_BAND = BASS_DECIMATION > 1 ? (int) BandLayout<BAND_COUNT>::BandsBelow(BASS_CROSSOVER) : 0;
+
+//
+// Tests
+//
+
+// A tone in the middle of each band lights that band the most, and the bands that aren't its neighbours hardly at
+// all.  A tone only a couple of bins above DC has barely a few cycles in the window, so its level swings a little
+// with its phase from frame to frame; it has to reach full scale at some point in the last bass window, not in
+// every frame.
+
+static void TestBandPlacement()
+{
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		float hz;
+		if (!BandCenter(iBand, hz))
+			continue;
+
+		Chain chain;
+		std::vector<Frame> frames = chain.Run(Tone(hz, 0.5f, SETTLE_SECONDS));
+		Frame frame = frames.back();
+		CHECK(LoudestBand(frame) == iBand, "%.0f Hz lit band %d, not band %d", hz, LoudestBand(frame), iBand);
+
+		float highest = 0.0f;
+		for (const Frame & recent : frames)
+			if (recent.Seconds > frame.Seconds - BASS_WINDOW_SECONDS)
+				highest = std::max(highest, recent.Peaks[iBand]);
+		CHECK(highest > 0.99f * FULL_SCALE_PEAK, "%.0f Hz only reached %.3f in band %d", hz, highest, iBand);
+	}
+}
+
+static void TestLeakage()
+{
+	const float MAX_LEAKAGE_DB = -35.0f;
+
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		float hz;
+		if (!BandCenter(iBand, hz))
+			continue;
+
+		Chain chain;
+		Frame frame = chain.Run(Tone(hz, 0.5f, SETTLE_SECONDS), true).back();
+		for (int iOther = 0; iOther < BAND_COUNT; iOther++)
+		{
+			if (abs(iOther - iBand) <= 1)
+				continue;
+			float leakage = Decibels(frame.Peaks[iOther] / frame.Peaks[iBand]);
+			CHECK(leakage < MAX_LEAKAGE_DB, "%.0f Hz (band %d) leaks %.1f dB into band %d", hz, iBand, leakage, iOther);
+		}
+	}
+}
+
+// A slow log sweep walks the loudest band up from the first band to the last without ever going backwards by more
+// than the bass FFT's longer window can account for
+
+static void TestSweep()
+{
+	float lowHz, highHz;
+	BandCenter(0, lowHz);
+	BandCenter(BAND_COUNT - 1, highHz);
+
+	const float seconds = 8.0f;
+	Signal sweep((size_t)(seconds * SAMPLING_FREQUENCY));
+	double phase = 0.0;
+	for (size_t i = 0; i < sweep.size(); i++)
+	{
+		double hz = lowHz * pow(highHz / lowHz, i / (double) sweep.size());
+		phase += 2 * M_PI * hz / SAMPLING_FREQUENCY;
+		sweep[i] = 0.5f * (float) sin(phase);
+	}
+
+	Chain chain;
+	std::vector<Frame> frames = chain.Run(sweep);
+
+	int	 highest = 0;
+	bool visited[BAND_COUNT] = { false };
+	for (const Frame & frame : frames)
+	{
+		if (frame.Seconds < BASS_WINDOW_SECONDS)
+			continue;
+		int loudest = LoudestBand(frame);
+		visited[loudest] = true;
+		CHECK(loudest >= highest - 1, "At %.2fs the sweep went back from band %d to %d", frame.Seconds, highest, loudest);
+		highest = std::max(highest, loudest);
+	}
+
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		float hz;
+		CHECK(visited[iBand] || !BandCenter(iBand, hz), "The sweep never made band %d the loudest", iBand);
+	}
+}
+
+// Three equal tones in three far apart bands are the three loudest bands.  Any of the three that's empty gives way
+// to the next band down that isn't.
+
+static void TestMultiTone()
+{
+	int bands[] = { BAND_COUNT / 6, BAND_COUNT / 2, BAND_COUNT - 2 };
+
+	Signal signal((size_t)(SETTLE_SECONDS * SAMPLING_FREQUENCY), 0.0f);
+	for (int & iBand : bands)
+	{
+		float hz;
+		while (!BandCenter(iBand, hz) && iBand > 0)
+			iBand--;
+		signal = signal + Tone(hz, 0.25f, SETTLE_SECONDS);
+	}
+
+	Chain chain;
+	Frame frame = chain.Run(signal).back();
+
+	float quietest = FULL_SCALE_PEAK;
+	for (int iBand : bands)
+		quietest = std::min(quietest, frame.Peaks[iBand]);
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		if (iBand == bands[0] || iBand == bands[1] || iBand == bands[2])
+			continue;
+		CHECK(frame.Peaks[iBand] < quietest, "Band %d (%.3f) is louder than a tone's band (%.3f)", iBand, frame.Peaks[iBand], quietest);
+	}
+}
+
+// Averaged over a few seconds, pink noise lights every band to about the same height, which is what the EQ is for.
+// Empty bands have nothing to light, so they're left out, mean and all.
+
+static void TestPinkNoise()
+{
+	const float MAX_ERROR_DB = 3.0f;
+
+	Chain chain;
+	std::vector<Frame> frames = chain.Run(Noise(10.0f, 0.5f, true), true);
+
+	double sums[BAND_COUNT] = { 0 }, logSum = 0.0;
+	size_t count = 0, bands = 0;
+	for (const Frame & frame : frames)
+	{
+		CHECK(Finite(frame), "Frame at %.2fs isn't finite", frame.Seconds);
+		if (frame.Seconds < SETTLE_SECONDS)
+			continue;
+		for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+			sums[iBand] += frame.Peaks[iBand] * chain.Buffer().BandGain(iBand);
+		count++;
+	}
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		if (BandIsEmpty(iBand))
+			continue;
+		logSum += log(std::max(sums[iBand] / count, 1e-9));
+		bands++;
+	}
+	const double mean = exp(logSum / bands);
+
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		if (BandIsEmpty(iBand))
+			continue;
+		float error = Decibels((float)(sums[iBand] / count / mean));
+		CHECK(fabsf(error) < MAX_ERROR_DB, "Band %d is %.1f dB off the others in pink noise", iBand, error);
+	}
+}
+
+// White noise lights every band that has any bins, and having more energy up high, the top half more than the bottom
+
+static void TestWhiteNoise()
+{
+	Chain chain;
+	std::vector<Frame> frames = chain.Run(Noise(5.0f, 0.2f, false), true);
+
+	double sums[BAND_COUNT] = { 0 };
+	for (const Frame & frame : frames)
+	{
+		CHECK(Finite(frame), "Frame at %.2fs isn't finite", frame.Seconds);
+		if (frame.Seconds >= SETTLE_SECONDS)
+			for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+				sums[iBand] += frame.Peaks[iBand];
+	}
+
+	double low = 0, high = 0;
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		CHECK(sums[iBand] > 0 || BandIsEmpty(iBand), "White noise never lit band %d", iBand);
+		(iBand < BAND_COUNT / 2 ? low : high) += sums[iBand];
+	}
+	CHECK(high > low, "White noise lit the bottom half (%.0f) more than the top (%.0f)", low, high);
+}
+
+// Silence, and a DC offset with nothing on it, light nothing and leave the gain on its floor
+
+static void TestSilence()
+{
+	for (float offset : { 0.0f, 0.25f, -0.4f })
+	{
+		Chain chain;
+		std::vector<Frame> frames = chain.Run(Signal((size_t)(SETTLE_SECONDS * SAMPLING_FREQUENCY), offset));
+		for (const Frame & frame : frames)
+		{
+			CHECK(Finite(frame), "Frame at %.2fs isn't finite", frame.Seconds);
+			for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+				CHECK(frame.Peaks[iBand] == 0.0f, "Offset %.2f lit band %d to %.4f", offset, iBand, frame.Peaks[iBand]);
+		}
+		CHECK(frames.back().Scaler == powf(2, 26), "Offset %.2f left the gain at %g", offset, frames.back().Scaler);
+	}
+}
+
+// A DC offset under a tone doesn't move any band by more than a fraction of a dB
+
+static void TestDCOffset()
+{
+	float hz;
+	BandCenter(BAND_COUNT / 2, hz);
+
+	Chain plain, offset;
+	Frame a = plain.Run(Tone(hz, 0.3f, SETTLE_SECONDS), true).back();
+	Frame b = offset.Run(Tone(hz, 0.3f, SETTLE_SECONDS) + Signal((size_t)(SETTLE_SECONDS * SAMPLING_FREQUENCY), 0.4f), true).back();
+
+	for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+	{
+		if (a.Peaks[iBand] < a.Peaks[BAND_COUNT / 2] * ENGINE_FLOOR)
+			continue;
+		float change = Decibels(b.Peaks[iBand] / a.Peaks[iBand]);
+		CHECK(fabsf(change) < 0.5f, "A DC offset moved band %d by %.2f dB", iBand, change);
+	}
+}
+
+// A tone clipped hard at the rails still lights its own band the most, stays finite, and stays on the display
+
+static void TestClipping()
+{
+	float hz;
+	BandCenter(BAND_COUNT / 4, hz);
+
+	Chain chain;
+	std::vector<Frame> frames = chain.Run(Tone(hz, 4.0f, SETTLE_SECONDS));
+	for (const Frame & frame : frames)
+	{
+		CHECK(Finite(frame), "Frame at %.2fs isn't finite", frame.Seconds);
+		for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+			CHECK(frame.Peaks[iBand] <= FULL_SCALE_PEAK * 1.0001f, "Band %d went off the top at %.3f", iBand, frame.Peaks[iBand]);
+	}
+	CHECK(LoudestBand(frames.back()) == BAND_COUNT / 4, "The clipped tone lit band %d, not %d", LoudestBand(frames.back()), BAND_COUNT / 4);
+}
+
+// When the music gets quieter the auto gain comes back up, keeping (GAIN_DAMPEN-1)/GAIN_DAMPEN of its excess each
+// window length, so a drop of N dB takes a predictable time to recover from whatever the overlap.  When it gets
+// louder the gain follows at once.
+
+static void TestGainConvergence()
+{
+	const float DROP_DB = 20.0f;
+	const int	iBand	= std::max(BAND_COUNT / 2, FIRST_MAIN_BAND);	// Timed against the main window, so not a bass band
+
+	float hz;
+	BandCenter(iBand, hz);
+
+	// The displayed peak is the band's level to the power gLogScale over the gain, so after a drop of DROP_DB the
+	// gain's excess over the new level starts at that power of the ratio, less one.  The peak is back within 10%
+	// of full scale once the excess is down to a ninth of the new level.
+
+	const float	 ratio		 = (powf(10.0f, DROP_DB * gLogScale / 20) - 1) / (1 / 0.9f - 1);
+	const float	 keep		 = (GAIN_DAMPEN - 1) / (float) GAIN_DAMPEN;
+	const float	 windowTime	 = MAX_SAMPLES / (float) SAMPLING_FREQUENCY;
+	const float	 expected	 = logf(ratio) / -logf(keep) * windowTime;
+
+	for (int overlap : { 1, 2, 4 })
+	{
+		Chain chain(overlap);
+		chain.Run(Tone(hz, 0.5f, 1.0f));
+
+		// Time it from the first frame that has only the quieter tone in its window
+
+		float start = chain.Seconds() + windowTime, settled = -1.0f;
+		std::vector<Frame> frames = chain.Run(Tone(hz, 0.5f * powf(10.0f, -DROP_DB / 20), 2.0f));
+		for (const Frame & frame : frames)
+		{
+			if (frame.Seconds >= start && frame.Peaks[iBand] >= 0.9f * FULL_SCALE_PEAK)
+			{
+				settled = frame.Seconds - start;
+				break;
+			}
+		}
+		CHECK(settled > 0, "Overlap %d: the gain never recovered from a %.0f dB drop", overlap, DROP_DB);
+		CHECK(fabsf(settled - expected) < 1.5f * windowTime, "Overlap %d: the gain took %.3fs to recover, not %.3fs", overlap, settled, expected);
+
+		frames = chain.Run(Tone(hz, 0.5f, windowTime * 2));
+		for (const Frame & frame : frames)
+			CHECK(frame.Peaks[iBand] <= FULL_SCALE_PEAK * 1.0001f, "Overlap %d: %.3f went off the top after a jump", overlap, frame.Peaks[iBand]);
+		CHECK(frames.back().Peaks[iBand] > 0.99f * FULL_SCALE_PEAK, "Overlap %d: the gain didn't follow a jump", overlap);
+	}
+}
+
+// Something too quiet to be anything but hiss stays under the gain's floor rather than filling the display
+
+static void TestGainFloor()
+{
+	float hz;
+	BandCenter(BAND_COUNT / 2, hz);
+
+	Chain chain;
+	Frame frame = chain.Run(Tone(hz, 0.002f, SETTLE_SECONDS)).back();
+	CHECK(frame.Scaler == powf(2, 26), "A quiet tone moved the gain off its floor to %g", frame.Scaler);
+	CHECK(frame.Peaks[BAND_COUNT / 2] < 0.5f * FULL_SCALE_PEAK, "A quiet tone filled %.3f of the display", frame.Peaks[BAND_COUNT / 2]);
+}
+
+// The bass decimator sees every sample exactly once whatever the overlap, and even when the sampler skips hops to
+// catch up, so a window ending at the same sample comes out the same every way.  The decimator's filters carry
+// state from one window to the next, so a sample missed or fed twice would show in the bass bands for a long time.
+
+static std::vector<Frame> AnalyzeWithSkips(const Signal & signal, size_t hopSize, size_t skipHops)
+{
+	SampleRing				 ring(SAMPLE_RING_SIZE);
+	SampleBuffer<BAND_COUNT> buffer(MAX_SAMPLES, SAMPLING_FREQUENCY);
+	buffer.SetHopSize(hopSize);
+
+	std::vector<Frame> frames;
+	size_t pushed = 0;
+	for (float sample : signal)
+	{
+		ring.Push(AdcSample(sample));
+		pushed++;
+
+		// After the first window, skip skipHops hops before each one, as a sampler that far behind would
+
+		const size_t skip = pushed > MAX_SAMPLES ? skipHops * hopSize : 0;
+		if (ring.Available() < MAX_SAMPLES + skip)
+			continue;
+
+		buffer.Skip(ring, skip);
+		buffer.LoadSamples(ring);
+		if (pushed % MAX_SAMPLES)
+			continue;												// Only windows that line up with the unoverlapped ones
+
+		buffer.FFT();
+		buffer.MeasureBands();
+		PeakData<BAND_COUNT> peaks = buffer.GetBandPeaks();
+		buffer.Reset();
+
+		Frame frame = Frame();
+		frame.Seconds = pushed / (float) SAMPLING_FREQUENCY;
+		for (size_t iBand = 0; iBand < BAND_COUNT; iBand++)
+			frame.Peaks[iBand] = peaks.Peaks[iBand];
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+static void TestDecimation()
+{
+	const Signal signal = Noise(SETTLE_SECONDS, 0.3f, true);
+
+	std::vector<Frame> reference = AnalyzeWithSkips(signal, MAX_SAMPLES, 0);
+	for (size_t skipHops : { 0, 1, 5 })
+	{
+		std::vector<Frame> frames = AnalyzeWithSkips(signal, MAX_SAMPLES / 4, skipHops);
+		CHECK(frames.size() >= reference.size() / 4, "Skipping %zu hops: only %zu windows", skipHops, frames.size());
+
+		for (const Frame & frame : frames)
+		{
+			const Frame & expected = reference[(size_t)(frame.Seconds * SAMPLING_FREQUENCY + 0.5f) / MAX_SAMPLES - 1];
+			for (size_t iBand = 0; iBand < BAND_COUNT; iBand++)
+				CHECK(fabsf(frame.Peaks[iBand] - expected.Peaks[iBand]) <= 1e-5f * expected.Peaks[iBand],
+					  "Skipping %zu hops: band %zu at %.2fs was %g, not %g", skipHops, iBand, frame.Seconds, frame.Peaks[iBand], expected.Peaks[iBand]);
+		}
+	}
+}
+
+// Two channels with a tone each light their own bands and not each other's.  Fed the same signal, each matches what
+// the mono chain makes of it, and as mid and side the side is silent; fed opposite signals, the mid is.
+
+static void TestStereo()
+{
+	const int bands[2] = { BAND_COUNT / 4, BAND_COUNT * 3 / 4 };
+
+	float hz[2];
+	for (int c = 0; c < 2; c++)
+		BandCenter(bands[c], hz[c]);
+
+	struct Case { const char * Name; Signal Left, Right; bool MidSide; };
+	const Signal tone = Tone(hz[0], 0.4f, SETTLE_SECONDS);
+	const Signal inverse = Tone(hz[0], -0.4f, SETTLE_SECONDS);
+	const Case cases[] =
+	{
+		{ "Apart",	   tone,	Tone(hz[1], 0.4f, SETTLE_SECONDS), false },
+		{ "Same",	   tone,	tone,	 false },
+		{ "Mono",	   tone,	tone,	 true  },
+		{ "Opposite",  tone,	inverse, true  },
+	};
+
+	Chain mono;
+	const Frame reference = mono.Run(tone).back();
+
+	for (const Case & test : cases)
+	{
+		ChannelRing<2>				ring(SAMPLE_RING_SIZE);
+		SampleBuffer<BAND_COUNT, 2> buffer(MAX_SAMPLES, SAMPLING_FREQUENCY);
+		buffer.SetHopSize(FFT_HOP);
+		buffer.SetMidSide(test.MidSide);
+
+		PeakData<BAND_COUNT> peaks[2];
+		for (size_t i = 0; i < test.Left.size(); i++)
+		{
+			const uint16_t frame[2] = { AdcSample(test.Left[i]), AdcSample(test.Right[i]) };
+			ring.Push(frame);
+			if (ring.Available() < MAX_SAMPLES)
+				continue;
+
+			buffer.LoadSamples(ring);
+			buffer.FFT();
+			buffer.ProcessPeaks();
+			for (int c = 0; c < 2; c++)
+				peaks[c] = buffer.GetBandPeaks(c);
+			buffer.Reset();
+		}
+
+		for (int c = 0; c < 2; c++)
+		{
+			Frame frame = Frame();
+			memcpy(frame.Peaks, peaks[c].Peaks, sizeof(frame.Peaks));
+			CHECK(Finite(frame), "%s: channel %d isn't finite", test.Name, c);
+
+			// Which channel should carry the tone, and in which band
+
+			bool silent = (!strcmp(test.Name, "Mono") && c == 1) || (!strcmp(test.Name, "Opposite") && c == 0);
+			int	 band	= !strcmp(test.Name, "Apart") ? bands[c] : bands[0];
+
+			if (silent)
+			{
+				for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+					CHECK(frame.Peaks[iBand] == 0.0f, "%s: channel %d lit band %d to %.4f", test.Name, c, iBand, frame.Peaks[iBand]);
+				continue;
+			}
+
+			CHECK(LoudestBand(frame) == band, "%s: channel %d lit band %d, not band %d", test.Name, c, LoudestBand(frame), band);
+			if (!strcmp(test.Name, "Apart"))
+			{
+				float crosstalk = Decibels(frame.Peaks[bands[1 - c]] / frame.Peaks[band]);
+				CHECK(crosstalk < -60.0f, "%s: channel %d picked up %.1f dB of the other", test.Name, c, crosstalk);
+			}
+			if (!strcmp(test.Name, "Same"))
+				for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+					CHECK(frame.Peaks[iBand] == reference.Peaks[iBand], "%s: channel %d band %d is %.6f, mono made %.6f", test.Name, c, iBand, frame.Peaks[iBand], reference.Peaks[iBand]);
+			else if (test.MidSide)
+				CHECK(frame.Peaks[band] > 0.99f * FULL_SCALE_PEAK, "%s: channel %d only reached %.3f", test.Name, c, frame.Peaks[band]);
+		}
+
+		// The channels share the auto gain, so only the louder of the two reaches the top
+
+		if (!strcmp(test.Name, "Apart"))
+		{
+			float top = std::max(peaks[0].Peaks[bands[0]], peaks[1].Peaks[bands[1]]);
+			CHECK(top > 0.99f * FULL_SCALE_PEAK, "%s: the louder channel only reached %.3f", test.Name, top);
+		}
+	}
+}
+
+// The sources feed the analyzer what they should.  A synthetic tone, mono and stereo, lands in its band with every
+// frame counted and none lost; a file delivered in blocks comes out exactly as it does delivered a frame at a time;
+// and the loopback stub wakes the sampler with silence on its own thread.
+
+static void TestSources()
+{
+	const int bands[2] = { BAND_COUNT / 3, BAND_COUNT * 2 / 3 };
+
+	float hz[2];
+	for (int c = 0; c < 2; c++)
+		BandCenter(bands[c], hz[c]);
+
+	{
+		SoundAnalyzer	   analyzer;
+		SyntheticSource<1> synthetic(SETTLE_SECONDS);
+		synthetic.AddTone(0, hz[0], 0.5f);
+
+		PeakData<BAND_COUNT> last;
+		size_t passes = analyzer.RunToEnd(synthetic, [&](const PeakData<BAND_COUNT> (&peaks)[1]) { last = peaks[0]; });
+
+		Frame frame = Frame();
+		memcpy(frame.Peaks, last.Peaks, sizeof(frame.Peaks));
+		CHECK(LoudestBand(frame) == bands[0], "The synthetic tone lit band %d, not band %d", LoudestBand(frame), bands[0]);
+
+		const size_t length = (size_t)(SETTLE_SECONDS * SAMPLING_FREQUENCY);
+		SampleStats	 stats	= analyzer.Stats().Snapshot();
+		CHECK(stats.Delivered == length, "The synthetic source delivered %llu frames, not %zu", (unsigned long long) stats.Delivered, length);
+		CHECK(stats.Misses == 0, "The analyzer lost %llu frames pumped a hop at a time", (unsigned long long) stats.Misses);
+		CHECK(passes == (length - MAX_SAMPLES) / FFT_HOP + 1, "%zu passes over %zu frames", passes, length);
+	}
+
+	{
+		SoundAnalyzer analyzer;
+		for (size_t overlap : { (size_t) 0, (size_t) 3, MAX_SAMPLES * 2 })
+			CHECK(!analyzer.SetOverlap(overlap), "An overlap of %zu was taken", overlap);
+
+		SyntheticSource<1> synthetic(SETTLE_SECONDS);
+		size_t passes = analyzer.RunToEnd(synthetic, [](const PeakData<BAND_COUNT> (&)[1]) { });
+
+		const size_t length = (size_t)(SETTLE_SECONDS * SAMPLING_FREQUENCY);
+		CHECK(passes == (length - MAX_SAMPLES) / FFT_HOP + 1, "%zu passes over %zu frames after a bad overlap", passes, length);
+		CHECK(analyzer.SetOverlap(4), "An overlap of 4 wasn't taken");
+	}
+
+	{
+		MultiChannelAnalyzer<2> analyzer;
+		SyntheticSource<2>		synthetic(SETTLE_SECONDS);
+		for (int c = 0; c < 2; c++)
+			synthetic.AddTone(c, hz[c], 0.5f);
+
+		PeakData<BAND_COUNT> last[2];
+		analyzer.RunToEnd(synthetic, [&](const PeakData<BAND_COUNT> (&peaks)[2]) { last[0] = peaks[0]; last[1] = peaks[1]; });
+		for (int c = 0; c < 2; c++)
+		{
+			Frame frame = Frame();
+			memcpy(frame.Peaks, last[c].Peaks, sizeof(frame.Peaks));
+			CHECK(LoudestBand(frame) == bands[c], "Synthetic channel %d lit band %d, not band %d", c, LoudestBand(frame), bands[c]);
+		}
+	}
+
+	{
+		const char * pszPath = "SoundFrameTests.raw";
+		const Signal tone	 = Tone(hz[1], 0.3f, 1.0f) + Noise(1.0f, 0.05f, true);
+
+		std::vector<int16_t> pcm(tone.size());
+		for (size_t i = 0; i < tone.size(); i++)
+			pcm[i] = (int16_t)(tone[i] * 32767);
+		FILE * pFile = fopen(pszPath, "wb");
+		CHECK(pFile && fwrite(pcm.data(), 2, pcm.size(), pFile) == pcm.size(), "Couldn't write %s", pszPath);
+		if (pFile)
+			fclose(pFile);
+
+		std::vector<PeakData<BAND_COUNT>> blocks, frames;
+
+		SoundAnalyzer blockAnalyzer;
+		FileSource<1> file(pszPath);
+		blockAnalyzer.RunToEnd(file, [&](const PeakData<BAND_COUNT> (&peaks)[1]) { blocks.push_back(peaks[0]); });
+		remove(pszPath);
+
+		SoundAnalyzer frameAnalyzer;
+		for (int16_t sample : pcm)
+		{
+			const uint16_t frame[1] = { ToAdcSample(sample) };
+			frameAnalyzer.Deliver(frame);
+			if (frameAnalyzer.Ready())
+				frames.push_back(frameAnalyzer.RunSamplerPass());
+		}
+
+		CHECK(blocks.size() == frames.size() && !blocks.empty(), "%zu passes from the file, %zu a frame at a time", blocks.size(), frames.size());
+		for (size_t i = 0; i < std::min(blocks.size(), frames.size()); i++)
+			for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+				CHECK(blocks[i].Peaks[iBand] == frames[i].Peaks[iBand], "Pass %zu band %d: %.6f from the file, %.6f a frame at a time", i, iBand, blocks[i].Peaks[iBand], frames[i].Peaks[iBand]);
+	}
+
+	{
+		SoundAnalyzer	  first, second;
+		TimerAdcSource<1> adc(0, 1), clash(0, 1 + SamplerTimers::TIMER_COUNT);
+		CHECK(first.Start(adc), "The ADC source didn't start on a free timer");
+		CHECK(!second.Start(clash), "A second ADC source took over a timer that was in use");
+
+		for (size_t i = 0; i < MAX_SAMPLES; i++)
+			HostTimerTick();
+		CHECK(first.Ready(), "The first ADC source stopped getting samples");
+		CHECK(second.Stats().Snapshot().Delivered == 0, "The refused ADC source was delivered %llu frames", (unsigned long long) second.Stats().Snapshot().Delivered);
+
+		first.Stop();
+		CHECK(second.Start(clash), "The ADC source couldn't have the timer once it was free");
+		second.Stop();
+	}
+
+	{
+		SoundAnalyzer	  analyzer;
+		LoopbackSource<1> loopback;
+		analyzer.SetSamplerTask(xTaskGetCurrentTaskHandle());
+		CHECK(analyzer.Start(loopback), "The loopback source didn't start");
+
+		for (int pass = 0; pass < 4; pass++)
+		{
+			PeakData<BAND_COUNT> peaks = analyzer.RunSamplerPass();
+			for (int iBand = 0; iBand < BAND_COUNT; iBand++)
+				CHECK(peaks.Peaks[iBand] == 0.0f, "Loopback silence lit band %d to %.4f", iBand, peaks.Peaks[iBand]);
+		}
+		analyzer.Stop();
+		CHECK(analyzer.Stats().Snapshot().Delivered >= MAX_SAMPLES + 3 * FFT_HOP, "The loopback source only delivered %llu frames", (unsigned long long) analyzer.Stats().Snapshot().Delivered);
+	}
+}
+
+// Times each stage of the chain on pink noise and holds it to its budget
+
+static void TestPerformance()
+{
+	Signal noise = Noise(10.0f, 0.5f, true);
+
+	Chain chain;
+	Instrumentation::Reset();
+	auto start = std::chrono::steady_clock::now();
+	chain.Run(noise);
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	Instrumentation::Dump();
+	float realtime = (float)(noise.size() / (double) SAMPLING_FREQUENCY / elapsed);
+	printf("%.1f seconds of audio per second\n", realtime);
+
+	struct { PipelineStage stage; float budget; } budgets[] =
+	{
+		{ STAGE_LOAD_SAMPLES,  LOAD_SAMPLES_BUDGET_US  },
+		{ STAGE_FFT,		   FFT_BUDGET_US		   },
+		{ STAGE_PROCESS_PEAKS, PROCESS_PEAKS_BUDGET_US },
+	};
+	for (const auto & budget : budgets)
+	{
+		float p50 = Instrumentation::CyclesToMicros(Instrumentation::Stage(budget.stage).Percentile(0.50f));
+		CHECK(p50 <= budget.budget, "%s took %.1f us, over its %.0f us budget", StageNames[budget.stage], p50, budget.budget);
+	}
+	CHECK(realtime >= MIN_REALTIME_FACTOR, "The chain only ran %.1f times real time", realtime);
+}
+
+static const struct { const char * Name; void (*Run)(); } Tests[] =
+{
+	{ "BandPlacement",	 TestBandPlacement	 },
+	{ "Leakage",		 TestLeakage		 },
+	{ "Sweep",			 TestSweep			 },
+	{ "MultiTone",		 TestMultiTone		 },
+	{ "PinkNoise",		 TestPinkNoise		 },
+	{ "WhiteNoise",		 TestWhiteNoise		 },
+	{ "Silence",		 TestSilence		 },
+	{ "DCOffset",		 TestDCOffset		 },
+	{ "Clipping",		 TestClipping		 },
+	{ "GainConvergence", TestGainConvergence },
+	{ "GainFloor",		 TestGainFloor		 },
+	{ "Decimation",		 TestDecimation		 },
+	{ "Stereo",			 TestStereo			 },
+	{ "Sources",		 TestSources		 },
+	{ "Performance",	 TestPerformance	 },
+};
+
+int main(int argc, char * argv[])
+{
+	int failed = 0, run = 0;
+	for (const auto & test : Tests)
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; i++)
+			selected |= !strcmp(argv[i], test.Name);
+		if (!selected)
+			continue;
+
+		printf("%s\n", test.Name);
+		fflush(stdout);
+		g_failures = 0;
+		test.Run();
+		run++;
+		if (g_failures)
+			failed++;
+	}
+
+	if (run == 0)
+	{
+		fprintf(stderr, "No such test\n");
+		return 1;
+	}
+	printf("%d of %d passed\n", run - failed, run);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        HostAudio.h
+//
+// Description:
+//
+//   Getting recorded audio into the host tools: reading PCM WAV and raw
+//   files, resampling them to the sampler's rate, and scaling them to what
+//   the ADC would have read.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+// ReadWavFrames
+//
+// Reads a 16 bit PCM WAV file as it is, channels interleaved.  Returns false if it isn't one.
+
+inline bool ReadWavFrames(const char * pszPath, std::vector<int16_t> & interleaved, uint16_t & channels, uint32_t & sampleRate)
+{
+	FILE * pFile = fopen(pszPath, "rb");
+	if (!pFile)
+		return false;
+
+	char	 riff[12];
+	uint16_t bits = 0;
+	bool	 ok = fread(riff, 1, 12, pFile) == 12 && !memcmp(riff, "RIFF", 4) && !memcmp(riff + 8, "WAVE", 4);
+
+	channels = 0;
+	while (ok)
+	{
+		char	 id[4];
+		uint32_t size;
+		if (fread(id, 1, 4, pFile) != 4 || fread(&size, 4, 1, pFile) != 1)
+		{
+			ok = false;
+			break;
+		}
+
+		if (!memcmp(id, "fmt ", 4))
+		{
+			uint8_t fmt[16];
+			ok = size >= 16 && fread(fmt, 1, 16, pFile) == 16;
+			uint16_t format;
+			memcpy(&format,	    fmt + 0,  2);
+			memcpy(&channels,   fmt + 2,  2);
+			memcpy(&sampleRate, fmt + 4,  4);
+			memcpy(&bits,	    fmt + 14, 2);
+			ok = ok && format == 1 && bits == 16 && channels > 0;
+			fseek(pFile, size - 16 + (size & 1), SEEK_CUR);
+		}
+		else if (!memcmp(id, "data", 4))
+		{
+			ok = channels > 0;
+			interleaved.resize(size / 2);
+			interleaved.resize(fread(interleaved.data(), 2, interleaved.size(), pFile));
+			interleaved.resize(interleaved.size() - interleaved.size() % std::max<uint16_t>(channels, 1));
+			break;
+		}
+		else
+			fseek(pFile, size + (size & 1), SEEK_CUR);
+	}
+
+	fclose(pFile);
+	return ok && !interleaved.empty();
+}
+
+// ReadWav
+//
+// Reads a 16 bit PCM WAV file into signed mono samples, averaging the channels if there's more than one.  Returns
+// false if it isn't one.
+
+inline bool ReadWav(const char * pszPath, std::vector<int16_t> & samples, uint32_t & sampleRate)
+{
+	std::vector<int16_t> interleaved;
+	uint16_t			 channels;
+	if (!ReadWavFrames(pszPath, interleaved, channels, sampleRate))
+		return false;
+
+	samples.reserve(interleaved.size() / channels);
+	for (size_t i = 0; i + channels <= interleaved.size(); i += channels)
+	{
+		int sum = 0;
+		for (uint16_t c = 0; c < channels; c++)
+			sum += interleaved[i + c];
+		samples.push_back((int16_t)(sum / channels));
+	}
+	return true;
+}
+
+// ReadRaw
+//
+// Reads a headerless file of 16 bit little endian samples, however many channels are interleaved in it
+
+inline bool ReadRaw(const char * pszPath, std::vector<int16_t> & interleaved)
+{
+	FILE * pFile = fopen(pszPath, "rb");
+	if (!pFile)
+		return false;
+
+	fseek(pFile, 0, SEEK_END);
+	long size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	interleaved.resize(size > 0 ? size / 2 : 0);
+	interleaved.resize(fread(interleaved.data(), 2, interleaved.size(), pFile));
+	fclose(pFile);
+	return !interleaved.empty();
+}
+
+// Resample
+//
+// Converts samples from one rate to another with a windowed sinc interpolator, lowpassed a little under the lower
+// of the two Nyquist frequencies so that nothing above it folds back into the bands.  Slow, but these are tools.
+
+inline std::vector<int16_t> Resample(const std::vector<int16_t> & input, uint32_t fromRate, uint32_t toRate)
+{
+	if (fromRate == toRate)
+		return input;
+
+	const int	 HalfTaps = 32;
+	const double cutoff	  = 0.45 * std::min(fromRate, toRate) / fromRate;	// In cycles per input sample
+	const double step	  = fromRate / (double) toRate;
+
+	std::vector<int16_t> output((size_t)(input.size() / step));
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		double t	= i * step;
+		long   n0	= (long) floor(t);
+		double sum	= 0.0;
+		for (long n = n0 - HalfTaps + 1; n <= n0 + HalfTaps; n++)
+		{
+			if (n < 0 || n >= (long) input.size())
+				continue;
+			double x	  = t - n;
+			double sinc	  = (x == 0.0) ? 2 * cutoff : sin(2 * M_PI * cutoff * x) / (M_PI * x);
+			double window = 0.5 + 0.5 * cos(M_PI * x / HalfTaps);
+			sum += input[n] * sinc * window;
+		}
+		output[i] = (int16_t) std::max(-32768.0, std::min(32767.0, round(sum)));
+	}
+	return output;
+}
+
+// ToAdcSample
+//
+// What the ADC would read for a signed sample, riding on the midpoint the way line level audio does
+
+inline uint16_t ToAdcSample(int16_t sample)
+{
+	return (uint16_t)(MAX_ANALOG_IN / 2 + sample * (MAX_ANALOG_IN / 2) / 32768);
+}
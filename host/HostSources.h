@@ -0,0 +1,234 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        HostSources.h
+//
+// Description:
+//
+//   Sample sources that only make sense on the host: recordings read from
+//   disk, and a stand-in for capturing whatever the machine is playing.
+//   Both deliver whole blocks, so the analyzer core runs on Linux just as
+//   it does behind the ADC, only as fast as the machine will go.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "HostAudio.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// FileSource
+//
+// Plays a recording into the analyzer whenever it's pumped, optionally looping it forever for a soak test.  Files
+// ending in .raw or .pcm are headerless 16 bit samples with Channels interleaved, already at the sampler's rate;
+// anything else is read as a 16 bit PCM WAV file and resampled if need be.  A mono analyzer gets a WAV file's
+// channels averaged, a wider one gets one channel of the file per channel, repeating the last if there are fewer.
+
+template <size_t Channels>
+class FileSource : public SampleSource<Channels>
+{
+	typedef MultiChannelAnalyzer<Channels> Analyzer;
+
+  private:
+
+	std::string			  _path;
+	bool				  _loop;
+	std::vector<uint16_t> _frames;						// The whole recording as the ADC would have read it, interleaved
+	size_t				  _position;					// In frames
+	Analyzer			* _pAnalyzer = nullptr;
+
+  public:
+
+	FileSource(const char * pszPath, bool loop = false)
+		: _path(pszPath),
+		  _loop(loop),
+		  _position(0)
+	{
+	}
+
+	const char * Name() const override
+	{
+		return "File";
+	}
+
+	// FileSource::Load
+	//
+	// Reads the file and converts it to frames of ADC readings, once.  Start does it if need be, but a tool timing the
+	// analyzer can call it first to keep the file out of its numbers.
+
+	bool Load()
+	{
+		if (!_frames.empty())
+			return true;
+
+		std::vector<int16_t> interleaved;
+		uint16_t			 channels	= Channels;
+		uint32_t			 sampleRate = SAMPLING_FREQUENCY;
+
+		const size_t dot  = _path.rfind('.');
+		const std::string extension = dot == std::string::npos ? "" : _path.substr(dot);
+		const bool	 raw  = extension == ".raw" || extension == ".pcm";
+		if (raw ? !ReadRaw(_path.c_str(), interleaved) : !ReadWavFrames(_path.c_str(), interleaved, channels, sampleRate))
+		{
+			fprintf(stderr, "%s isn't a 16 bit %s file\n", _path.c_str(), raw ? "raw" : "PCM WAV");
+			return false;
+		}
+
+		// Pull the file's channels apart, mixed down for a mono analyzer, and bring each to the sampler's rate
+
+		const size_t		 length = interleaved.size() / channels;
+		std::vector<int16_t> vChannels[Channels];
+		for (size_t c = 0; c < Channels; c++)
+		{
+			vChannels[c].resize(length);
+			for (size_t i = 0; i < length; i++)
+			{
+				if (Channels == 1)
+				{
+					int sum = 0;
+					for (uint16_t f = 0; f < channels; f++)
+						sum += interleaved[i * channels + f];
+					vChannels[c][i] = (int16_t)(sum / channels);
+				}
+				else
+					vChannels[c][i] = interleaved[i * channels + std::min<size_t>(c, channels - 1)];
+			}
+			if (sampleRate != SAMPLING_FREQUENCY)
+				vChannels[c] = Resample(vChannels[c], sampleRate, SAMPLING_FREQUENCY);
+		}
+		if (sampleRate != SAMPLING_FREQUENCY)
+			fprintf(stderr, "Resampling %s from %u Hz to %d Hz\n", _path.c_str(), sampleRate, (int) SAMPLING_FREQUENCY);
+
+		_frames.resize(vChannels[0].size() * Channels);
+		for (size_t i = 0; i < vChannels[0].size(); i++)
+			for (size_t c = 0; c < Channels; c++)
+				_frames[i * Channels + c] = ToAdcSample(vChannels[c][i]);
+		return !_frames.empty();
+	}
+
+	// FileSource::Frames, FileSource::Position
+	//
+	// How long the recording is and how far into it the analyzer has been fed, both in frames
+
+	size_t Frames() const
+	{
+		return _frames.size() / Channels;
+	}
+
+	size_t Position() const
+	{
+		return _position;
+	}
+
+	bool Start(Analyzer & analyzer) override
+	{
+		if (!Load())
+			return false;
+		_pAnalyzer = &analyzer;
+		_position  = 0;
+		return true;
+	}
+
+	void Stop() override
+	{
+		_pAnalyzer = nullptr;
+	}
+
+	// FileSource::Pump
+	//
+	// Delivers straight out of the recording, a block at a time, going back to the start at the end if looping
+
+	size_t Pump(size_t maxFrames) override
+	{
+		if (!_pAnalyzer)
+			return 0;
+
+		size_t delivered = 0;
+		while (delivered < maxFrames)
+		{
+			if (_position == Frames())
+			{
+				if (!_loop)
+					break;
+				_position = 0;
+			}
+
+			const size_t count = std::min(maxFrames - delivered, Frames() - _position);
+			_pAnalyzer->Deliver(_frames.data() + _position * Channels, count);
+			_position += count;
+			delivered += count;
+		}
+		return delivered;
+	}
+};
+
+// LoopbackSource
+//
+// Where capturing whatever the host is playing would go.  It runs the way a real capture would, on its own thread
+// at the sampler's rate, delivering a hop's worth of frames at a time to wake the sampler task.  Wiring up the
+// machine's audio API is left for when a tool needs it, so for now every block is silence at the ADC's midpoint.
+
+template <size_t Channels>
+class LoopbackSource : public SampleSource<Channels>
+{
+	typedef MultiChannelAnalyzer<Channels> Analyzer;
+
+  private:
+
+	std::thread		  _thread;
+	std::atomic<bool> _running;
+
+	// Capture
+	//
+	// The capture thread: a block every hop period, paced against the clock so it doesn't drift
+
+	void Capture(Analyzer * pAnalyzer)
+	{
+		std::vector<uint16_t> block(FFT_HOP * Channels, (uint16_t)(MAX_ANALOG_IN / 2));
+		const auto			  period = std::chrono::microseconds(FFT_HOP * 1000000ull / SAMPLING_FREQUENCY);
+
+		auto next = std::chrono::steady_clock::now();
+		while (_running)
+		{
+			next += period;
+			std::this_thread::sleep_until(next);
+			pAnalyzer->Deliver(block.data(), FFT_HOP);
+		}
+	}
+
+  public:
+
+	LoopbackSource()
+		: _running(false)
+	{
+	}
+
+	~LoopbackSource()
+	{
+		Stop();
+	}
+
+	const char * Name() const override
+	{
+		return "Loopback";
+	}
+
+	bool Start(Analyzer & analyzer) override
+	{
+		Stop();
+		_running = true;
+		_thread	 = std::thread(&LoopbackSource::Capture, this, &analyzer);
+		return true;
+	}
+
+	void Stop() override
+	{
+		_running = false;
+		if (_thread.joinable())
+			_thread.join();
+	}
+};
@@ -0,0 +1,37 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        SoundFrameHost.h
+//
+// Description:
+//
+//   The host equivalent of the top of SoundFrameIRQ.ino: pulls in the
+//   stand-in libraries from host/include and then the very same project
+//   headers, in the same order, that the sketch builds on the ESP32.
+//   Each host tool is a single translation unit that includes this.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <Arduino.h>                                        // millis, analogRead, portMUX, timers, Serial
+#include <FastLED.h>                                        // CRGB and palettes
+#include <Adafruit_GFX.h>                                   // Drawing primitives
+#include <arduinoFFT.h>                                     // FFT math for sound
+
+#include "Globals.h"
+#include "Utilities.h"
+#include "Instrumentation.h"
+#include "Statistics.h"
+#include "LEDMatrixGFX.h"
+#include "Palettes.h"
+#include "BandLayout.h"
+#include "FFTWindow.h"
+#include "FFTEngine.h"
+#include "SampleRing.h"
+#include "Decimator.h"
+#include "TripleBuffer.h"
+#include "SpectrumDisplay.h"
+#include "SoundAnalyzer.h"
+#include "SampleSource.h"
@@ -0,0 +1,158 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Adafruit_GFX.h
+//
+// Description:
+//
+//   Thin host stand-in for Adafruit_GFX 1.2.9.  Only the primitives the
+//   display actually uses are here, and they funnel down to drawPixel the
+//   same way the real library's default implementations do, so per-pixel
+//   costs measured on the host have the same shape as on the device.
+//   Text is accepted and ignored.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
+
+class Adafruit_GFX
+{
+  protected:
+
+	int16_t WIDTH;
+	int16_t HEIGHT;
+	int16_t _width;
+	int16_t _height;
+
+  public:
+
+	Adafruit_GFX(int16_t w, int16_t h)
+		: WIDTH(w), HEIGHT(h), _width(w), _height(h)
+	{
+	}
+
+	virtual ~Adafruit_GFX()
+	{
+	}
+
+	virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+	virtual void startWrite()
+	{
+	}
+
+	virtual void endWrite()
+	{
+	}
+
+	virtual void writePixel(int16_t x, int16_t y, uint16_t color)
+	{
+		drawPixel(x, y, color);
+	}
+
+	// writeLine
+	//
+	// Bresenham's algorithm, as in the library
+
+	virtual void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+	{
+		bool steep = abs(y1 - y0) > abs(x1 - x0);
+		if (steep)
+		{
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+		if (x0 > x1)
+		{
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+		}
+
+		int16_t dx = x1 - x0;
+		int16_t dy = abs(y1 - y0);
+		int16_t err = dx / 2;
+		int16_t ystep = (y0 < y1) ? 1 : -1;
+
+		for (; x0 <= x1; x0++)
+		{
+			if (steep)
+				writePixel(y0, x0, color);
+			else
+				writePixel(x0, y0, color);
+			err -= dy;
+			if (err < 0)
+			{
+				y0 += ystep;
+				err += dx;
+			}
+		}
+	}
+
+	virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+	{
+		startWrite();
+		writeLine(x, y, x, y + h - 1, color);
+		endWrite();
+	}
+
+	virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+	{
+		startWrite();
+		writeLine(x, y, x + w - 1, y, color);
+		endWrite();
+	}
+
+	virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+	{
+		startWrite();
+		for (int16_t i = x; i < x + w; i++)
+			drawFastVLine(i, y, h, color);
+		endWrite();
+	}
+
+	virtual void fillScreen(uint16_t color)
+	{
+		fillRect(0, 0, _width, _height, color);
+	}
+
+	virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+	{
+		if (x0 == x1)
+		{
+			if (y0 > y1)
+				std::swap(y0, y1);
+			drawFastVLine(x0, y0, y1 - y0 + 1, color);
+		}
+		else if (y0 == y1)
+		{
+			if (x0 > x1)
+				std::swap(x0, x1);
+			drawFastHLine(x0, y0, x1 - x0 + 1, color);
+		}
+		else
+		{
+			startWrite();
+			writeLine(x0, y0, x1, y1, color);
+			endWrite();
+		}
+	}
+
+	int16_t width() const
+	{
+		return _width;
+	}
+
+	int16_t height() const
+	{
+		return _height;
+	}
+
+	// Text output is only used for the on-screen FPS debug display
+
+	void setCursor(int16_t, int16_t)	{}
+	void setTextColor(uint16_t)			{}
+	template <typename T> void print(T)	{}
+};
@@ -0,0 +1,403 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        Arduino.h
+//
+// Description:
+//
+//   Thin host (Linux) stand-in for the bits of the Arduino/ESP32 core that
+//   the analyzer and display code touch: millis, delay, the cycle counter,
+//   analogRead, the portMUX spinlocks, the hardware timer, a few FreeRTOS
+//   task and semaphore calls, and Serial.  Just enough to run the real
+//   headers on a workstation; nothing here talks to hardware.
+//
+//   analogRead is routed through a callback so the host tools can feed the
+//   sampler whatever signal they like, and the timer ISR is driven by hand
+//   through HostTimerTick().
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+
+// Time
+
+inline std::chrono::steady_clock::time_point HostStartTime()
+{
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return start;
+}
+
+inline unsigned long millis()
+{
+	return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - HostStartTime()).count();
+}
+
+inline unsigned long micros()
+{
+	return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - HostStartTime()).count();
+}
+
+inline void delay(unsigned long ms)
+{
+	if (ms == 0)
+		std::this_thread::yield();
+	else
+		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield()
+{
+	std::this_thread::yield();
+}
+
+// Cycle counter
+//
+// The host has no portable cycle counter, so it counts nanoseconds instead and reports a 1GHz "CPU" to match.
+// Like the real one it's 32 bits and wraps, so only differences mean anything.
+
+class EspClass
+{
+  public:
+
+	uint32_t getCycleCount()
+	{
+		return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - HostStartTime()).count();
+	}
+};
+
+static EspClass ESP;
+
+inline uint32_t getCpuFrequencyMhz()
+{
+	return 1000;
+}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// ADC
+//
+// By default every pin reads as zero.  Host tools install their own reader to synthesize or replay a signal.
+
+typedef uint16_t (*HostAnalogReadFn)(uint8_t pin);
+
+inline HostAnalogReadFn & HostAnalogReader()
+{
+	static HostAnalogReadFn pfn = nullptr;
+	return pfn;
+}
+
+inline void HostSetAnalogReader(HostAnalogReadFn pfn)
+{
+	HostAnalogReader() = pfn;
+}
+
+inline uint16_t analogRead(uint8_t pin)
+{
+	HostAnalogReadFn pfn = HostAnalogReader();
+	return pfn ? pfn(pin) : 0;
+}
+
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+
+#define INPUT 0x01
+
+inline void pinMode(uint8_t, uint8_t)                         {}
+inline void analogReadResolution(uint8_t)                     {}
+inline void analogSetWidth(uint8_t)                           {}
+inline void analogSetCycles(uint8_t)                          {}
+inline void analogSetSamples(uint8_t)                         {}
+inline void analogSetClockDiv(uint8_t)                        {}
+inline void analogSetAttenuation(adc_attenuation_t)           {}
+inline void analogSetPinAttenuation(uint8_t, adc_attenuation_t) {}
+
+// portMUX
+//
+// On the ESP32 these are cross-core spinlocks.  Here they're a simple test-and-set on the owner word, which is all
+// the sampler needs from them.
+
+struct portMUX_TYPE
+{
+	uint32_t owner;
+	uint32_t count;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED	{ 0, 0 }
+#define portMUX_TRY_LOCK				0
+#define portMUX_NO_TIMEOUT				(-1)
+
+inline void vPortCPUInitializeMutex(portMUX_TYPE * pMux)
+{
+	__atomic_store_n(&pMux->owner, 0, __ATOMIC_RELEASE);
+	pMux->count = 0;
+}
+
+inline bool vPortCPUAcquireMutexTimeout(portMUX_TYPE * pMux, int timeout)
+{
+	for (;;)
+	{
+		uint32_t expected = 0;
+		if (__atomic_compare_exchange_n(&pMux->owner, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		{
+			pMux->count = 1;
+			return true;
+		}
+		if (timeout == portMUX_TRY_LOCK)
+			return false;
+		std::this_thread::yield();
+	}
+}
+
+inline void vPortCPUAcquireMutex(portMUX_TYPE * pMux)
+{
+	vPortCPUAcquireMutexTimeout(pMux, portMUX_NO_TIMEOUT);
+}
+
+inline void vPortCPUReleaseMutex(portMUX_TYPE * pMux)
+{
+	pMux->count = 0;
+	__atomic_store_n(&pMux->owner, 0, __ATOMIC_RELEASE);
+}
+
+// There's no interrupt to mask on the host; the timer "ISR" only runs when a tool calls HostTimerTick
+
+#define portDISABLE_INTERRUPTS()	do { } while (0)
+#define portENABLE_INTERRUPTS()		do { } while (0)
+
+// Hardware timer
+//
+// timerBegin hands out one of the four timers; HostTimerTick fires the ISR of every enabled timer once.
+
+struct hw_timer_t
+{
+	void	  (*pfnISR)();
+	uint64_t	alarm;
+	bool		enabled;
+};
+
+inline hw_timer_t * HostTimers()
+{
+	static hw_timer_t timers[4] = { };
+	return timers;
+}
+
+inline hw_timer_t * timerBegin(uint8_t num, uint16_t, bool)
+{
+	return &HostTimers()[num & 3];
+}
+
+inline void timerAttachInterrupt(hw_timer_t * timer, void (*pfn)(), bool)
+{
+	timer->pfnISR = pfn;
+}
+
+inline void timerAlarmWrite(hw_timer_t * timer, uint64_t alarm, bool)
+{
+	timer->alarm = alarm;
+}
+
+inline void timerAlarmEnable(hw_timer_t * timer)
+{
+	timer->enabled = true;
+}
+
+inline void timerAlarmDisable(hw_timer_t * timer)
+{
+	timer->enabled = false;
+}
+
+inline void timerDetachInterrupt(hw_timer_t * timer)
+{
+	timer->pfnISR = nullptr;
+}
+
+inline void timerEnd(hw_timer_t * timer)
+{
+	*timer = hw_timer_t();
+}
+
+inline void HostTimerTick()
+{
+	for (int i = 0; i < 4; i++)
+		if (HostTimers()[i].enabled && HostTimers()[i].pfnISR)
+			HostTimers()[i].pfnISR();
+}
+
+// FreeRTOS
+//
+// Tasks are detached threads (the core and priority are ignored), and a task's notification count and a binary
+// semaphore are each guarded by a condition variable.  Timeouts are in ms, which is what a tick is on the ESP32.
+
+typedef uint32_t TickType_t;
+typedef int		 BaseType_t;
+
+#define portMAX_DELAY		((TickType_t) 0xffffffff)
+#define pdMS_TO_TICKS(ms)	((TickType_t)(ms))
+#define pdTRUE				1
+#define pdFALSE				0
+#define pdPASS				pdTRUE
+
+#define portYIELD_FROM_ISR()		do { } while (0)				// Still a statement, so it can be an if's whole body
+
+struct HostTask
+{
+	std::mutex				lock;
+	std::condition_variable signal;
+	uint32_t				notifications = 0;
+};
+
+typedef HostTask * TaskHandle_t;
+
+// Threads that weren't started through xTaskCreate, like main, get a task of their own the first time they ask
+
+inline TaskHandle_t & HostCurrentTask()
+{
+	thread_local TaskHandle_t task = nullptr;
+	return task;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+	if (!HostCurrentTask())
+		HostCurrentTask() = new HostTask;
+	return HostCurrentTask();
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*pfnTask)(void *), const char *, uint32_t, void * pParam, unsigned, TaskHandle_t * pHandle, int)
+{
+	TaskHandle_t handle = new HostTask;
+	std::thread([=] { HostCurrentTask() = handle; pfnTask(pParam); }).detach();
+	if (pHandle)
+		*pHandle = handle;
+	return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t)
+{
+}
+
+inline BaseType_t xTaskCreate(void (*pfnTask)(void *), const char * pszName, uint32_t stack, void * pParam, unsigned priority, TaskHandle_t * pHandle)
+{
+	return xTaskCreatePinnedToCore(pfnTask, pszName, stack, pParam, priority, pHandle, -1);
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task)
+{
+	std::lock_guard<std::mutex> lock(task->lock);
+	task->notifications++;
+	task->signal.notify_one();
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t * pHigherPriorityTaskWoken)
+{
+	xTaskNotifyGive(task);
+	if (pHigherPriorityTaskWoken)
+		*pHigherPriorityTaskWoken = pdTRUE;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+	TaskHandle_t task = xTaskGetCurrentTaskHandle();
+	std::unique_lock<std::mutex> lock(task->lock);
+	auto notified = [task] { return task->notifications > 0; };
+	if (ticks == portMAX_DELAY)
+		task->signal.wait(lock, notified);
+	else if (!task->signal.wait_for(lock, std::chrono::milliseconds(ticks), notified))
+		return 0;
+
+	uint32_t count = task->notifications;
+	task->notifications = clearOnExit ? 0 : count - 1;
+	return count;
+}
+
+struct HostSemaphore
+{
+	std::mutex				lock;
+	std::condition_variable signal;
+	bool					given = false;
+};
+
+typedef HostSemaphore * SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+	return new HostSemaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+	std::unique_lock<std::mutex> lock(sem->lock);
+	auto given = [sem] { return sem->given; };
+	if (ticks == portMAX_DELAY)
+		sem->signal.wait(lock, given);
+	else if (!sem->signal.wait_for(lock, std::chrono::milliseconds(ticks), given))
+		return pdFALSE;
+	sem->given = false;
+	return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	std::lock_guard<std::mutex> lock(sem->lock);					// Notify under the lock so the taker can delete it as soon as it wakes
+	if (sem->given)
+		return pdFALSE;
+	sem->given = true;
+	sem->signal.notify_one();
+	return pdTRUE;
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	delete sem;
+}
+
+// Serial
+//
+// Goes to stderr so that tool output on stdout stays machine readable.
+
+class HostSerial
+{
+  public:
+
+	void begin(unsigned long) {}
+
+	int printf(const char * format, ...) __attribute__((format(printf, 2, 3)))
+	{
+		va_list args;
+		va_start(args, format);
+		int n = vfprintf(stderr, format, args);
+		va_end(args);
+		return n;
+	}
+
+	void print(const char * psz)	{ fputs(psz, stderr); }
+	void print(double value)		{ fprintf(stderr, "%.2f", value); }
+	void print(long value)			{ fprintf(stderr, "%ld", value); }
+	void print(unsigned long value) { fprintf(stderr, "%lu", value); }
+	void print(int value)			{ fprintf(stderr, "%d", value); }
+	void println(const char * psz = "") { fprintf(stderr, "%s\n", psz); }
+};
+
+static HostSerial Serial;
@@ -0,0 +1,227 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        FastLED.h
+//
+// Description:
+//
+//   Thin host stand-in for the parts of FastLED we use: CRGB, the 256
+//   entry palettes and gradient palettes, ColorFromPalette, and the
+//   FastLED controller object.  show() doesn't drive any wires, it just
+//   counts frames so the host tools can see how often it was called, and
+//   can optionally take as long as sending the frame to WS2812Bs would.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
+#include <initializer_list>
+
+typedef uint8_t TProgmemRGBGradientPalette_byte;
+typedef const TProgmemRGBGradientPalette_byte * TProgmemRGBGradientPalettePtr;
+
+#define DEFINE_GRADIENT_PALETTE(X) extern const TProgmemRGBGradientPalette_byte X[] =
+
+// scale8
+//
+// Same rounding as FastLED's FASTLED_SCALE8_FIXED version, so faded colors match the device bit for bit
+
+inline uint8_t scale8(uint8_t i, uint8_t scale)
+{
+	return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8);
+}
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, uint8_t frac)
+{
+	if (b > a)
+		return a + scale8(b - a, frac);
+	return a - scale8(a - b, frac);
+}
+
+struct CRGB
+{
+	uint8_t r;
+	uint8_t g;
+	uint8_t b;
+
+	typedef enum : uint32_t
+	{
+		Black		= 0x000000,
+		Blue		= 0x0000FF,
+		DarkBlue	= 0x00008B,
+		DarkRed		= 0x8B0000,
+		Green		= 0x008000,
+		LightBlue	= 0xADD8E6,
+		Maroon		= 0x800000,
+		Orange		= 0xFFA500,
+		Red			= 0xFF0000,
+		SkyBlue		= 0x87CEEB,
+		White		= 0xFFFFFF,
+		Yellow		= 0xFFFF00,
+	} HTMLColorCode;
+
+	CRGB() = default;
+
+	constexpr CRGB(uint8_t ir, uint8_t ig, uint8_t ib)
+		: r(ir), g(ig), b(ib)
+	{
+	}
+
+	constexpr CRGB(uint32_t colorcode)
+		: r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF)
+	{
+	}
+
+	constexpr CRGB(HTMLColorCode colorcode)
+		: CRGB((uint32_t)colorcode)
+	{
+	}
+
+	CRGB & nscale8(uint8_t scale)
+	{
+		r = scale8(r, scale);
+		g = scale8(g, scale);
+		b = scale8(b, scale);
+		return *this;
+	}
+
+	CRGB & fadeToBlackBy(uint8_t fadefactor)
+	{
+		return nscale8(255 - fadefactor);
+	}
+
+	bool operator==(const CRGB & rhs) const
+	{
+		return r == rhs.r && g == rhs.g && b == rhs.b;
+	}
+
+	bool operator!=(const CRGB & rhs) const
+	{
+		return !(*this == rhs);
+	}
+};
+
+inline void fill_solid(CRGB * pLEDs, int count, const CRGB & color)
+{
+	for (int i = 0; i < count; i++)
+		pLEDs[i] = color;
+}
+
+typedef enum { NOBLEND = 0, LINEARBLEND = 1 } TBlendType;
+
+// CRGBPalette256
+//
+// A list of N colors is spread evenly over the 256 entries and blended between, which for 16 colors is exactly
+// what FastLED's CRGBPalette16 -> CRGBPalette256 upscale does.  Gradient palettes are (index, r, g, b) anchors
+// that are linearly filled in between.
+
+class CRGBPalette256
+{
+  public:
+
+	CRGB entries[256];
+
+	CRGBPalette256()
+	{
+		memset(entries, 0, sizeof(entries));
+	}
+
+	CRGBPalette256(std::initializer_list<CRGB> colors)
+	{
+		const CRGB * pColors = colors.begin();
+		size_t count = colors.size();
+		for (int i = 0; i < 256; i++)
+		{
+			size_t iColor = i * count / 256;
+			uint8_t frac  = (uint8_t)((i * count) % 256);
+			const CRGB & a = pColors[iColor];
+			const CRGB & b = pColors[(iColor + 1) % count];
+			entries[i] = CRGB(lerp8by8(a.r, b.r, frac), lerp8by8(a.g, b.g, frac), lerp8by8(a.b, b.b, frac));
+		}
+	}
+
+	CRGBPalette256(TProgmemRGBGradientPalettePtr pGradient)
+	{
+		const uint8_t * p = pGradient;
+		int    iStart = p[0];
+		CRGB   start(p[1], p[2], p[3]);
+		do
+		{
+			p += 4;
+			int  iEnd = p[0];
+			CRGB end(p[1], p[2], p[3]);
+			for (int i = iStart; i <= iEnd; i++)
+			{
+				uint8_t frac = (iEnd == iStart) ? 0 : (uint8_t)((i - iStart) * 255 / (iEnd - iStart));
+				entries[i] = CRGB(lerp8by8(start.r, end.r, frac), lerp8by8(start.g, end.g, frac), lerp8by8(start.b, end.b, frac));
+			}
+			iStart = iEnd;
+			start  = end;
+		} while (iStart < 255);
+	}
+
+	const CRGB & operator[](uint8_t index) const
+	{
+		return entries[index];
+	}
+};
+
+inline CRGB ColorFromPalette(const CRGBPalette256 & pal, uint8_t index, uint8_t brightness = 255, TBlendType = LINEARBLEND)
+{
+	CRGB color = pal.entries[index];
+	if (brightness != 255)
+		color.nscale8(brightness);
+	return color;
+}
+
+// Controller
+
+typedef enum { RGB = 0012, GRB = 0102 } EOrder;
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER = GRB> class WS2812B {};
+
+class CFastLED
+{
+	CRGB	* _pLEDs		= nullptr;
+	int		  _cLEDs		= 0;
+	uint8_t	  _brightness	= 255;
+	uint64_t  _cShows		= 0;
+	bool	  _wireTime		= false;
+
+  public:
+
+	static constexpr int WIRE_MICROS_PER_LED = 30;		// 24 bits at 800kHz
+
+	template <template <uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+	CFastLED & addLeds(CRGB * pLEDs, int cLEDs)
+	{
+		_pLEDs = pLEDs;
+		_cLEDs = cLEDs;
+		return *this;
+	}
+
+	// Like the real one, show() sends at the global brightness and show(scale) at the one given, leaving it alone
+
+	void show()
+	{
+		show(_brightness);
+	}
+
+	void show(uint8_t /* scale */)
+	{
+		if (_wireTime)
+			std::this_thread::sleep_for(std::chrono::microseconds(_cLEDs * WIRE_MICROS_PER_LED + 50));
+		__atomic_fetch_add(&_cShows, 1, __ATOMIC_RELAXED);
+	}
+
+	void SimulateWireTime(bool enable)	{ _wireTime = enable; }
+	void setBrightness(uint8_t scale)	{ _brightness = scale; }
+	uint8_t getBrightness() const		{ return _brightness; }
+	uint64_t ShowCount() const			{ return _cShows; }
+	const CRGB * Leds() const			{ return _pLEDs; }
+	int Size() const					{ return _cLEDs; }
+};
+
+static CFastLED FastLED;
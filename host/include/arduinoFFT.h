@@ -0,0 +1,211 @@
+//+--------------------------------------------------------------------------
+//
+// SoundFrameIRQ - (c) 2018 Dave Plummer.  All Rights Reserved.
+//
+// File:        arduinoFFT.h
+//
+// Description:
+//
+//   Host stand-in for arduinoFFT 1.4.0, following the library's own
+//   algorithms (in-place radix-2 with the cosine recurrence for the
+//   twiddles, symmetric windowing, peak interpolation) so that both the
+//   output and the cost of the double precision path match the device.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
+
+#define FFT_FORWARD						0x01
+#define FFT_REVERSE						0x00
+
+#define FFT_WIN_TYP_RECTANGLE			0x00
+#define FFT_WIN_TYP_HAMMING				0x01
+#define FFT_WIN_TYP_HANN				0x02
+#define FFT_WIN_TYP_TRIANGLE			0x03
+#define FFT_WIN_TYP_NUTTALL				0x04
+#define FFT_WIN_TYP_BLACKMAN			0x05
+#define FFT_WIN_TYP_BLACKMAN_NUTTALL	0x06
+#define FFT_WIN_TYP_BLACKMAN_HARRIS		0x07
+#define FFT_WIN_TYP_FLT_TOP				0x08
+#define FFT_WIN_TYP_WELCH				0x09
+
+class arduinoFFT
+{
+  public:
+
+	void Windowing(double * vData, uint16_t samples, uint8_t windowType, uint8_t dir)
+	{
+		const double twoPi		= 6.28318531;
+		const double fourPi		= 12.56637061;
+		const double sixPi		= 18.84955593;
+
+		double samplesMinusOne = double(samples) - 1.0;
+		for (uint16_t i = 0; i < (samples >> 1); i++)
+		{
+			double indexMinusOne  = double(i);
+			double ratio          = indexMinusOne / samplesMinusOne;
+			double weighingFactor = 1.0;
+
+			switch (windowType)
+			{
+				case FFT_WIN_TYP_RECTANGLE:
+					weighingFactor = 1.0;
+					break;
+				case FFT_WIN_TYP_HAMMING:
+					weighingFactor = 0.54 - (0.46 * cos(twoPi * ratio));
+					break;
+				case FFT_WIN_TYP_HANN:
+					weighingFactor = 0.54 * (1.0 - cos(twoPi * ratio));
+					break;
+				case FFT_WIN_TYP_TRIANGLE:
+					weighingFactor = 1.0 - ((2.0 * fabs(indexMinusOne - (samplesMinusOne / 2.0))) / samplesMinusOne);
+					break;
+				case FFT_WIN_TYP_NUTTALL:
+					weighingFactor = 0.355768 - (0.487396 * cos(twoPi * ratio)) + (0.144232 * cos(fourPi * ratio)) - (0.012604 * cos(sixPi * ratio));
+					break;
+				case FFT_WIN_TYP_BLACKMAN:
+					weighingFactor = 0.42323 - (0.49755 * cos(twoPi * ratio)) + (0.07922 * cos(fourPi * ratio));
+					break;
+				case FFT_WIN_TYP_BLACKMAN_NUTTALL:
+					weighingFactor = 0.3635819 - (0.4891775 * cos(twoPi * ratio)) + (0.1365995 * cos(fourPi * ratio)) - (0.0106411 * cos(sixPi * ratio));
+					break;
+				case FFT_WIN_TYP_BLACKMAN_HARRIS:
+					weighingFactor = 0.35875 - (0.48829 * cos(twoPi * ratio)) + (0.14128 * cos(fourPi * ratio)) - (0.01168 * cos(sixPi * ratio));
+					break;
+				case FFT_WIN_TYP_FLT_TOP:
+					weighingFactor = 0.2810639 - (0.5208972 * cos(twoPi * ratio)) + (0.1980399 * cos(fourPi * ratio));
+					break;
+				case FFT_WIN_TYP_WELCH:
+				{
+					double t = (indexMinusOne - (samplesMinusOne / 2.0)) / (samplesMinusOne / 2.0);
+					weighingFactor = 1.0 - t * t;
+					break;
+				}
+			}
+
+			if (dir == FFT_FORWARD)
+			{
+				vData[i] *= weighingFactor;
+				vData[samples - (i + 1)] *= weighingFactor;
+			}
+			else
+			{
+				vData[i] /= weighingFactor;
+				vData[samples - (i + 1)] /= weighingFactor;
+			}
+		}
+	}
+
+	void Compute(double * vReal, double * vImag, uint16_t samples, uint8_t dir)
+	{
+		Compute(vReal, vImag, samples, Exponent(samples), dir);
+	}
+
+	void Compute(double * vReal, double * vImag, uint16_t samples, uint8_t power, uint8_t dir)
+	{
+		// Reverse bits
+
+		uint16_t j = 0;
+		for (uint16_t i = 0; i < (samples - 1); i++)
+		{
+			if (i < j)
+			{
+				std::swap(vReal[i], vReal[j]);
+				if (dir == FFT_REVERSE)
+					std::swap(vImag[i], vImag[j]);
+			}
+			uint16_t k = (samples >> 1);
+			while (k <= j)
+			{
+				j -= k;
+				k >>= 1;
+			}
+			j += k;
+		}
+
+		// Compute the FFT
+
+		double   c1 = -1.0;
+		double   c2 = 0.0;
+		uint16_t l2 = 1;
+		for (uint8_t l = 0; l < power; l++)
+		{
+			uint16_t l1 = l2;
+			l2 <<= 1;
+			double u1 = 1.0;
+			double u2 = 0.0;
+			for (j = 0; j < l1; j++)
+			{
+				for (uint16_t i = j; i < samples; i += l2)
+				{
+					uint16_t i1 = i + l1;
+					double t1 = u1 * vReal[i1] - u2 * vImag[i1];
+					double t2 = u1 * vImag[i1] + u2 * vReal[i1];
+					vReal[i1] = vReal[i] - t1;
+					vImag[i1] = vImag[i] - t2;
+					vReal[i] += t1;
+					vImag[i] += t2;
+				}
+				double z = (u1 * c1) - (u2 * c2);
+				u2 = (u1 * c2) + (u2 * c1);
+				u1 = z;
+			}
+			c2 = sqrt((1.0 - c1) / 2.0);
+			if (dir == FFT_FORWARD)
+				c2 = -c2;
+			c1 = sqrt((1.0 + c1) / 2.0);
+		}
+
+		// Scaling for reverse transform
+
+		if (dir != FFT_FORWARD)
+		{
+			for (uint16_t i = 0; i < samples; i++)
+			{
+				vReal[i] /= samples;
+				vImag[i] /= samples;
+			}
+		}
+	}
+
+	void ComplexToMagnitude(double * vReal, double * vImag, uint16_t samples)
+	{
+		for (uint16_t i = 0; i < samples; i++)
+			vReal[i] = sqrt(vReal[i] * vReal[i] + vImag[i] * vImag[i]);
+	}
+
+	double MajorPeak(double * vD, uint16_t samples, double samplingFrequency)
+	{
+		double   maxY = 0;
+		uint16_t IndexOfMaxY = 0;
+		for (uint16_t i = 1; i < ((samples >> 1) + 1); i++)
+		{
+			if ((vD[i - 1] < vD[i]) && (vD[i] > vD[i + 1]))
+			{
+				if (vD[i] > maxY)
+				{
+					maxY = vD[i];
+					IndexOfMaxY = i;
+				}
+			}
+		}
+		if (IndexOfMaxY == 0)												// The library reads vD[-1] here; we don't
+			return 0.0;
+
+		double delta = 0.5 * ((vD[IndexOfMaxY - 1] - vD[IndexOfMaxY + 1]) / (vD[IndexOfMaxY - 1] - (2.0 * vD[IndexOfMaxY]) + vD[IndexOfMaxY + 1]));
+		double interpolatedX = ((IndexOfMaxY + delta) * samplingFrequency) / (samples - 1);
+		if (IndexOfMaxY == (samples >> 1))
+			interpolatedX = ((IndexOfMaxY + delta) * samplingFrequency) / samples;
+		return interpolatedX;
+	}
+
+	uint8_t Exponent(uint16_t value)
+	{
+		uint8_t result = 0;
+		while (((value >> result) & 1) != 1)
+			result++;
+		return result;
+	}
+};